@@ -0,0 +1,1012 @@
+#include "maze.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <stack>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/*
+ Benchmarks for the maze generator.
+ Usage: maze_bench [carve|algos|allocs|simd|ops|serve|edits|layers|pbfs|image] [--sizes 101,201,...] [--legacy-max N]
+                   [--storage bytes|compact] [--levels N] [--threads 1,2,4,...] [--json PATH]
+ Sizes are odd grid dimensions; each size generates one square maze.
+ Without a suite name every suite runs except ops, the full sweep of generation,
+ solving, save/load, printing and rendering over every algorithm, and serve, which
+ compares cache misses and hits of a maze_server on a local socket, and edits,
+ which re-solves after random wall edits incrementally and from scratch, and
+ layers, which compares the 2D generator with the N-dimensional lattice and
+ times layered mazes of --levels floors (default 8), and pbfs, which times the
+ parallel solver at each of --threads (default 1, 2, 4, 8) against bfs, and
+ image, which renders solved mazes as text and as each image format at each
+ of --threads.
+ --json also writes every measurement to PATH ("-" for standard output) so runs
+ of different releases can be compared.
+ */
+
+namespace {
+
+// Heap usage of the whole process, maintained by the replaced operator new/delete below.
+// Suites allocate on several threads, so every field is atomic; relaxed order is enough for counts.
+struct heap_counters {
+    std::atomic<size_t> current{0}, peak{0}, allocations{0};
+} heap;
+
+}
+
+// Every block carries its size in front so delete can keep the live byte count exact.
+// Kept out of line: inlined into callers, GCC mistakes the offset header for an out-of-bounds access.
+__attribute__((noinline)) void *operator new(size_t size) {
+    void *p = std::malloc(size + 16);
+    if (!p)
+        throw std::bad_alloc();
+    *static_cast<size_t *>(p) = size;
+    const size_t now = heap.current.fetch_add(size, std::memory_order_relaxed) + size;
+    size_t peak = heap.peak.load(std::memory_order_relaxed);
+    while (now > peak && !heap.peak.compare_exchange_weak(peak, now, std::memory_order_relaxed)) {
+    }
+    heap.allocations.fetch_add(1, std::memory_order_relaxed);
+    return static_cast<char *>(p) + 16;
+}
+__attribute__((noinline)) void operator delete(void *p) noexcept {
+    if (!p)
+        return;
+    char *base = static_cast<char *>(p) - 16;
+    heap.current.fetch_sub(*reinterpret_cast<size_t *>(base), std::memory_order_relaxed);
+    std::free(base);
+}
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete[](void *p) noexcept { operator delete(p); }
+void operator delete(void *p, size_t) noexcept { operator delete(p); }
+void operator delete[](void *p, size_t) noexcept { operator delete(p); }
+
+namespace {
+
+using bench_clock = std::chrono::steady_clock;
+
+// Silences std::cout while generator status messages would flood the results.
+struct quiet_cout {
+    std::stringstream sink;
+    std::streambuf *saved;
+    quiet_cout() : saved(std::cout.rdbuf(sink.rdbuf())) {}
+    ~quiet_cout() { std::cout.rdbuf(saved); }
+};
+
+/*
+ Reference copy of the original carving loop, which rescans the whole grid
+ for unvisited cells after every step. Kept here only to measure the gain.
+ */
+struct legacy_carver {
+    int width, height;
+    std::vector<std::vector<char>> grid;
+    std::vector<std::vector<bool>> visited;
+    std::mt19937 rng;
+
+    legacy_carver(int w, int h) : width(w), height(h), rng(std::random_device{}()) {}
+
+    bool if_unvisited() const {
+        for (int i = 1; i < height; i += 2)
+            for (int j = 1; j < width; j += 2)
+                if (!visited[i][j])
+                    return true;
+        return false;
+    }
+
+    std::vector<maze_gen::cell> get_unvisited_cells() const {
+        std::vector<maze_gen::cell> res;
+        for (int i = 1; i < height; i += 2)
+            for (int j = 1; j < width; j += 2)
+                if (!visited[i][j])
+                    res.emplace_back(i, j);
+        return res;
+    }
+
+    std::vector<maze_gen::cell> get_neighbors(maze_gen::cell &c) const {
+        std::vector<maze_gen::cell> res;
+        std::vector<maze_gen::cell> cells;
+        cells.insert(cells.end(), {maze_gen::cell(c.x, c.y - 2), maze_gen::cell(c.x + 2, c.y),
+                                   maze_gen::cell(c.x, c.y + 2), maze_gen::cell(c.x - 2, c.y)});
+        for (maze_gen::cell n : cells)
+            if (n.x < (unsigned)height && n.y < (unsigned)width && n.x > 0 && n.y > 0 &&
+                grid[n.x][n.y] != WALL && !visited[n.x][n.y])
+                res.push_back(n);
+        return res;
+    }
+
+    void generate() {
+        grid.assign(height, std::vector<char>(width, WALL));
+        visited.assign(height, std::vector<bool>(width, false));
+        for (int i = 1; i < height - 1; i += 2)
+            for (int j = 1; j < width - 1; j += 2)
+                grid[i][j] = CELL;
+
+        std::stack<maze_gen::cell> st;
+        maze_gen::cell current(1, 1);
+        visited[1][1] = VISITED;
+        do {
+            std::vector<maze_gen::cell> neighbors = get_neighbors(current);
+            if (neighbors.size() > 0) {
+                std::shuffle(neighbors.begin(), neighbors.end(), rng);
+                maze_gen::cell next = neighbors[0];
+                st.push(current);
+                grid[(current.x + next.x) / 2][(current.y + next.y) / 2] = CELL;
+                visited[(current.x + next.x) / 2][(current.y + next.y) / 2] = VISITED;
+                current = next;
+                visited[current.x][current.y] = VISITED;
+            } else if (st.size() > 1) {
+                st.pop();
+                current = st.top();
+            } else if (if_unvisited()) {
+                st = std::stack<maze_gen::cell>();
+                std::vector<maze_gen::cell> unvisited = get_unvisited_cells();
+                std::shuffle(unvisited.begin(), unvisited.end(), rng);
+                current = unvisited[0];
+                visited[current.x][current.y] = VISITED;
+            } else {
+                break;
+            }
+        } while (if_unvisited());
+    }
+};
+
+template <typename F>
+double time_ms(F &&f) {
+    auto start = bench_clock::now();
+    f();
+    return std::chrono::duration<double, std::milli>(bench_clock::now() - start).count();
+}
+
+// Resident set high-water mark of the process in KiB.
+long peak_rss_kb() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+        if (line.compare(0, 6, "VmHWM:") == 0)
+            return std::atol(line.c_str() + 6);
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// Lowers the high-water mark to the current RSS where the kernel allows it, so each operation gets its own peak.
+void reset_peak_rss() {
+    int fd = open("/proc/self/clear_refs", O_WRONLY);
+    if (fd < 0)
+        return;
+    (void)!write(fd, "5", 1);
+    close(fd);
+}
+
+// Cost of one run of an operation.
+struct measurement {
+    double ms = 0;           // Mean time per run
+    size_t allocations = 0;  // Heap allocations per run
+    size_t peak_heap = 0;    // Heap bytes above the starting level at the peak
+    long peak_rss_kb = 0;    // Process RSS high-water mark after the runs
+};
+
+/*
+ Runs f reps times and measures time, allocations and memory.
+ param reps Runs averaged; the peaks cover all of them.
+ */
+template <typename F>
+measurement measure(F &&f, int reps = 1) {
+    measurement m;
+    reset_peak_rss();
+    const size_t base = heap.current, allocations = heap.allocations;
+    heap.peak.store(base, std::memory_order_relaxed);
+    m.ms = time_ms([&] {
+               for (int i = 0; i < reps; ++i)
+                   f();
+           }) / reps;
+    m.allocations = (heap.allocations - allocations) / reps;
+    m.peak_heap = heap.peak - base;
+    m.peak_rss_kb = peak_rss_kb();
+    return m;
+}
+
+// One measured operation, as written to the JSON report.
+struct bench_record {
+    std::string suite, operation, variant;
+    int size;
+    double cells;
+    measurement m;
+};
+
+std::vector<bench_record> records;
+
+void record(const char *suite, const std::string &operation, const std::string &variant, int size,
+            const measurement &m) {
+    records.push_back({suite, operation, variant, size, double((size - 1) / 2) * ((size - 1) / 2), m});
+}
+
+/*
+ Writes every record as one JSON document.
+ return False if the file could not be written.
+ */
+bool write_json(const std::string &path, maze_gen::storage_mode storage) {
+    std::ofstream file;
+    if (path != "-")
+        file.open(path);
+    std::ostream &out = path == "-" ? std::cout : file;
+    out << "{\"benchmark\":\"maze_bench\",\"storage\":\""
+        << (storage == maze_gen::storage_mode::compact ? "compact" : "bytes") << "\",\"results\":[";
+    for (size_t i = 0; i < records.size(); ++i) {
+        const bench_record &r = records[i];
+        out << (i ? ",\n" : "\n") << "{\"suite\":\"" << r.suite << "\",\"operation\":\"" << r.operation
+            << "\",\"variant\":\"" << r.variant << "\",\"size\":" << r.size << ",\"cells\":" << r.cells
+            << ",\"ms\":" << r.m.ms << ",\"ns_per_cell\":" << (r.cells > 0 ? r.m.ms * 1e6 / r.cells : 0)
+            << ",\"allocations\":" << r.m.allocations << ",\"peak_heap_bytes\":" << r.m.peak_heap
+            << ",\"peak_rss_kb\":" << r.m.peak_rss_kb << "}";
+    }
+    out << "\n]}" << std::endl;
+    return bool(out);
+}
+
+// Discards whatever is written to it, so printing can be timed without a terminal; counts the bytes.
+struct null_buffer : std::streambuf {
+    size_t bytes = 0;
+    int overflow(int c) override {
+        ++bytes;
+        return c;
+    }
+    std::streamsize xsputn(const char *, std::streamsize n) override {
+        bytes += size_t(n);
+        return n;
+    }
+};
+
+std::vector<int> parse_sizes(const char *arg) {
+    std::vector<int> res;
+    std::stringstream ss(arg);
+    std::string item;
+    while (std::getline(ss, item, ','))
+        res.push_back(std::atoi(item.c_str()));
+    return res;
+}
+
+// Compares the original scanning carve loop with the counter-based engine.
+void bench_carve(const std::vector<int> &sizes, int legacy_max) {
+    std::printf("%-8s %12s %14s %14s %10s\n", "size", "cells", "legacy_ms", "linear_ms", "speedup");
+    for (int size : sizes) {
+        double legacy = -1;
+        if (size <= legacy_max) {
+            legacy_carver ref(size, size);
+            measurement m = measure([&] { ref.generate(); });
+            record("carve", "generate", "legacy", size, m);
+            legacy = m.ms;
+        }
+
+        maze_gen::maze_generator gen(size, size);
+        double linear;
+        {
+            quiet_cout quiet;
+            measurement m = measure([&] { gen.generate_maze(); });
+            record("carve", "generate", "linear", size, m);
+            linear = m.ms;
+        }
+
+        long long cells = (long long)((size - 1) / 2) * ((size - 1) / 2);
+        if (legacy >= 0)
+            std::printf("%-8d %12lld %14.2f %14.2f %9.1fx\n", size, cells, legacy, linear, legacy / linear);
+        else
+            std::printf("%-8d %12lld %14s %14.2f %10s\n", size, cells, "skipped", linear, "-");
+        std::fflush(stdout);
+    }
+}
+
+/*
+ Compares the generation algorithms on time and peak heap use. The peak is measured
+ from the start of each generation, so it covers the maze storage plus the
+ algorithm's working memory.
+ */
+void bench_algos(const std::vector<int> &sizes, maze_gen::storage_mode storage) {
+    std::printf("%-12s %-8s %12s %12s %10s %14s\n", "algorithm", "size", "time_ms", "ns/cell", "peak_MB",
+                "peak_bytes/cell");
+    for (int size : sizes) {
+        for (maze_gen::maze_algorithm algo : maze_gen::all_algorithms()) {
+            maze_gen::maze_generator gen(size, size);
+            gen.set_storage(storage);
+            gen.set_algorithm(algo);
+            gen.set_seed(1);
+
+            measurement m;
+            {
+                quiet_cout quiet;
+                m = measure([&] { gen.generate_maze(); });
+            }
+            record("algos", "generate", maze_gen::algorithm_name(algo), size, m);
+
+            double cells = double((size - 1) / 2) * ((size - 1) / 2);
+            std::printf("%-12s %-8d %12.2f %12.1f %10.2f %14.2f\n", maze_gen::algorithm_name(algo), size, m.ms,
+                        m.ms * 1e6 / cells, m.peak_heap / 1048576.0, m.peak_heap / cells);
+            std::fflush(stdout);
+        }
+    }
+}
+
+/*
+ Counts heap allocations on the per-step paths. Generation is measured on the second
+ maze of a generator, once its buffers exist, so only allocations that happen per maze
+ or per step show up; neighbor enumeration is measured over every cell.
+ return Number of hot paths that allocated.
+ */
+int bench_allocs(const std::vector<int> &sizes) {
+    std::printf("%-24s %-8s %12s %12s %14s\n", "operation", "size", "steps", "allocations", "allocs/step");
+    int failures = 0;
+    auto report = [&](const char *what, int size, size_t steps, size_t allocations, bool must_be_zero) {
+        std::printf("%-24s %-8d %12zu %12zu %14.6f%s\n", what, size, steps, allocations,
+                    steps ? double(allocations) / steps : 0.0, must_be_zero && allocations ? "  FAIL" : "");
+        std::fflush(stdout);
+        failures += must_be_zero && allocations;
+        measurement m;
+        m.allocations = allocations;
+        record("allocs", what, must_be_zero ? "must_be_zero" : "", size, m);
+    };
+
+    for (int size : sizes) {
+        const size_t cells = size_t((size - 1) / 2) * ((size - 1) / 2);
+        maze_gen::maze_generator gen(size, size);
+        gen.set_verbose(false);
+        gen.set_seed(1);
+        gen.generate_maze();
+
+        size_t before = heap.allocations;
+        gen.generate_maze();
+        report("generate backtracker", size, cells, heap.allocations - before, true);
+
+        // Visit every cell with the visited plane as generation leaves it (all visited)
+        size_t found = 0;
+        before = heap.allocations;
+        for (int x = 1; x < size - 1; x += 2)
+            for (int y = 1; y < size - 1; y += 2) {
+                found += gen.get_neighbors(maze_gen::cell(x, y)).size();
+                found += gen.get_neighbors_solver(maze_gen::cell(x, y)).size();
+            }
+        report("get_neighbors(_solver)", size, 2 * cells, heap.allocations - before, true);
+
+        for (maze_gen::solver_algorithm algo : {maze_gen::solver_algorithm::bfs, maze_gen::solver_algorithm::astar,
+                                                maze_gen::solver_algorithm::bidirectional,
+                                                maze_gen::solver_algorithm::dfs}) {
+            before = heap.allocations;
+            maze_gen::solve_result res =
+                gen.find_path(algo, maze_gen::cell(1, 1), maze_gen::cell(size - 2, size - 2));
+            const size_t allocations = heap.allocations - before;
+            const std::string what = std::string("solve ") + maze_gen::solver_name(algo);
+            report(what.c_str(), size, res.stats.nodes_expanded, allocations, false);
+        }
+        (void)found;
+    }
+
+    // Mixed sizes through one batch worker: once both sizes have been built, buffers are only recycled
+    std::vector<maze_gen::batch_job> jobs;
+    for (int i = 0; i < 1000; ++i)
+        jobs.emplace_back(i % 2 ? 41 : 21, i % 2 ? 31 : 21, maze_gen::maze_algorithm::backtracker, uint64_t(i));
+    maze_gen::maze_batch batch(1);
+    std::vector<maze_gen::batch_result> results;
+    batch.run(jobs, results);
+    const size_t before = heap.allocations;
+    batch.run(jobs, results);
+    report("batch mazes, mixed sizes", 41, jobs.size(), heap.allocations - before, true);
+    return failures;
+}
+
+/*
+ Sweeps sizes and generation algorithms over every operation a maze goes through:
+ generate, each solver, save and load in both file layouts, print_maze's row
+ output and a full terminal frame. Small mazes are run repeatedly so every
+ measurement covers about a million cells. The peaks of generate include the
+ maze itself; the later operations reuse it, so their peaks are working memory only.
+ return Number of operations that failed.
+ */
+int bench_ops(const std::vector<int> &sizes, maze_gen::storage_mode storage) {
+    std::printf("%-12s %-20s %-8s %6s %12s %10s %12s %10s %10s\n", "algorithm", "operation", "size", "runs",
+                "ms/run", "ns/cell", "allocs/run", "peak_MB", "rss_MB");
+    const std::string path = "maze_bench_" + std::to_string(getpid()) + ".maze";
+    null_buffer discard;
+    std::ostream null_out(&discard);
+    const int null_fd = open("/dev/null", O_WRONLY);
+    int failures = 0;
+
+    for (int size : sizes) {
+        const double cells = double((size - 1) / 2) * ((size - 1) / 2);
+        const int reps = int(std::max(1.0, std::min(1000.0, 1e6 / cells)));
+        for (maze_gen::maze_algorithm algo : maze_gen::all_algorithms()) {
+            const char *algo_name = maze_gen::algorithm_name(algo);
+            maze_gen::maze_generator gen(size, size);
+            gen.set_verbose(false);
+            gen.set_storage(storage);
+            gen.set_algorithm(algo);
+            gen.set_seed(1);
+            auto run = [&](const std::string &operation, int runs, const std::function<bool()> &f) {
+                bool ok = true;
+                measurement m = measure([&] { ok = f() && ok; }, runs);
+                record("ops", operation, algo_name, size, m);
+                std::printf("%-12s %-20s %-8d %6d %12.3f %10.1f %12zu %10.2f %10.1f%s\n", algo_name, operation.c_str(),
+                            size, runs, m.ms, m.ms * 1e6 / cells, m.allocations, m.peak_heap / 1048576.0,
+                            m.peak_rss_kb / 1024.0, ok ? "" : "  FAIL");
+                std::fflush(stdout);
+                failures += !ok;
+            };
+
+            run("generate", reps, [&] {
+                gen.generate_maze();
+                return true;
+            });
+            for (maze_gen::solver_algorithm solver :
+                 {maze_gen::solver_algorithm::bfs, maze_gen::solver_algorithm::astar,
+                  maze_gen::solver_algorithm::bidirectional, maze_gen::solver_algorithm::dfs})
+                run(std::string("solve ") + maze_gen::solver_name(solver), reps, [&] {
+                    return gen.find_path(solver, maze_gen::cell(1, 1), maze_gen::cell(size - 2, size - 2)).found;
+                });
+
+            for (bool compress : {true, false}) {
+                const std::string layout = compress ? "binary" : "stored";
+                gen.set_compression(compress);
+                run("save " + layout, reps, [&] { return gen.save(path); });
+                run("load " + layout, reps, [&] { return gen.load(path); });
+            }
+            run("print", reps, [&] {
+                maze_gen::text_sink sink(null_out);
+                gen.write_rows(sink);
+                return sink.ok();
+            });
+
+            // Every frame is drawn in full, as after a resize; play() normally sends only changes
+            const maze_gen::maze &m = gen.get_maze();
+            maze_gen::terminal_renderer screen(null_fd);
+            screen.resize(size + 1, 2 * size);
+            run("render", reps, [&] {
+                screen.invalidate();
+                screen.draw(size, size, [&](int x, int y) {
+                    const bool wall = storage == maze_gen::storage_mode::compact ? m.packed.is_wall(x, y)
+                                                                                  : m.grid(x, y) == WALL;
+                    return wall ? WALL : CELL;
+                }, "");
+                return true;
+            });
+        }
+    }
+    close(null_fd);
+    std::remove(path.c_str());
+    return failures;
+}
+
+/*
+ Compares the row kernels of simd.h with their scalar versions over whole grids.
+ The visited grid has one unvisited cell in 64 and the text rows one PATH position
+ in 256, about what carving and solving leave. Every pair must give identical output.
+ return Number of kernels whose results differed.
+ */
+int bench_simd(const std::vector<int> &sizes) {
+    std::printf("kernels: %s\n", maze_gen::simd::level());
+    std::printf("%-20s %-8s %12s %12s %10s\n", "kernel", "size", "scalar_ms", "vector_ms", "speedup");
+    int failures = 0;
+    for (int size : sizes) {
+        maze_gen::grid2d<char> grid(size, size, WALL);
+        maze_gen::grid2d<unsigned char> visited(size, size, 1);
+        maze_gen::maze_rng rng(1);
+        for (int i = 1; i < size - 1; i += 2)
+            for (int j = 1; j < size - 1; j += 2)
+                visited(i, j) = rng.bounded(64) != 0;
+        std::vector<char> text(maze_gen::simd::text_row_capacity(size));
+        std::vector<char> marked(size);
+        const int reps = std::max(1, 4000000 / (size * size));
+
+        auto compare = [&](const char *kernel, const std::function<size_t()> &scalar,
+                           const std::function<size_t()> &vector) {
+            size_t a = 0, b = 0;
+            const measurement ms = measure([&] { a += scalar(); }, reps);
+            const measurement mv = measure([&] { b += vector(); }, reps);
+            record("simd", kernel, "scalar", size, ms);
+            record("simd", kernel, maze_gen::simd::level(), size, mv);
+            std::printf("%-20s %-8d %12.3f %12.3f %9.1fx%s\n", kernel, size, ms.ms, mv.ms, ms.ms / mv.ms,
+                        a == b ? "" : "  MISMATCH");
+            std::fflush(stdout);
+            failures += a != b;
+        };
+
+        // Results are folded into a checksum so both versions are compared and nothing is optimized away
+        compare("fill_lattice", [&] {
+            size_t sum = 0;
+            for (int i = 1; i < size - 1; i += 2) {
+                maze_gen::simd::scalar::fill_lattice_row(grid.row(i), size);
+                sum += size_t(grid(i, size / 2)) + size_t(grid(i, size - 1)) * 3;
+            }
+            return sum;
+        }, [&] {
+            size_t sum = 0;
+            for (int i = 1; i < size - 1; i += 2) {
+                maze_gen::simd::fill_lattice_row(grid.row(i), size);
+                sum += size_t(grid(i, size / 2)) + size_t(grid(i, size - 1)) * 3;
+            }
+            return sum;
+        });
+        compare("count_unvisited", [&] {
+            size_t n = 0;
+            for (int i = 1; i < size - 1; i += 2)
+                n += maze_gen::simd::scalar::count_unvisited_row(visited.row(i), size - 1);
+            return n;
+        }, [&] {
+            size_t n = 0;
+            for (int i = 1; i < size - 1; i += 2)
+                n += maze_gen::simd::count_unvisited_row(visited.row(i), size - 1);
+            return n;
+        });
+        compare("next_unvisited", [&] {
+            size_t sum = 0;
+            for (int i = 1; i < size - 1; i += 2)
+                for (int j = maze_gen::simd::scalar::next_unvisited_in_row(visited.row(i), 1, size - 1); j < size - 1;
+                     j = maze_gen::simd::scalar::next_unvisited_in_row(visited.row(i), j + 1, size - 1))
+                    sum += size_t(j);
+            return sum;
+        }, [&] {
+            size_t sum = 0;
+            for (int i = 1; i < size - 1; i += 2)
+                for (int j = maze_gen::simd::next_unvisited_in_row(visited.row(i), 1, size - 1); j < size - 1;
+                     j = maze_gen::simd::next_unvisited_in_row(visited.row(i), j + 1, size - 1))
+                    sum += size_t(j);
+            return sum;
+        });
+
+        for (int j = 0; j < size; ++j)
+            marked[j] = rng.bounded(256) ? grid(1, j) : PATH;
+        for (bool highlight : {false, true}) {
+            const char *row = highlight ? marked.data() : grid.row(1);
+            auto checksum = [&](size_t n) { return n + size_t(text[n / 2]) * 7 + size_t(text[n - 1]); };
+            compare(highlight ? "expand_text_colored" : "expand_text", [&] {
+                size_t sum = 0;
+                for (int i = 0; i < size; ++i)
+                    sum += checksum(maze_gen::simd::scalar::expand_text_row(row, size, text.data(), highlight));
+                return sum;
+            }, [&] {
+                size_t sum = 0;
+                for (int i = 0; i < size; ++i)
+                    sum += checksum(maze_gen::simd::expand_text_row(row, size, text.data(), highlight));
+                return sum;
+            });
+        }
+    }
+    return failures;
+}
+
+// Client side of the maze_server protocol, reading responses through its own buffer.
+class serve_client {
+    int fd_;
+    std::string buffer_;
+
+    bool read_line(std::string &line) {
+        size_t eol;
+        while ((eol = buffer_.find('\n')) == std::string::npos) {
+            char chunk[65536];
+            const ssize_t n = read(fd_, chunk, sizeof(chunk));
+            if (n <= 0)
+                return false;
+            buffer_.append(chunk, size_t(n));
+        }
+        line.assign(buffer_, 0, eol);
+        buffer_.erase(0, eol + 1);
+        return true;
+    }
+
+public:
+    explicit serve_client(const std::string &path) : fd_(socket(AF_UNIX, SOCK_STREAM, 0)) {
+        sockaddr_un addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+        if (connect(fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+            close(fd_);
+            fd_ = -1;
+        }
+    }
+    ~serve_client() {
+        if (fd_ >= 0)
+            close(fd_);
+    }
+    bool ok() const { return fd_ >= 0; }
+
+    // Sends one request and reads the whole response; returns its first line, empty on failure.
+    std::string request(const std::string &line) {
+        const std::string sent = line + "\n";
+        std::string header, row;
+        if (fd_ < 0 || write(fd_, sent.data(), sent.size()) != ssize_t(sent.size()) || !read_line(header))
+            return std::string();
+        if (header.compare(0, 3, "OK ") == 0 && header[3] != '{')
+            for (int rows = std::atoi(header.c_str() + 3); rows > 0; --rows)
+                if (!read_line(row))
+                    return std::string();
+        return header;
+    }
+};
+
+/*
+ Serves mazes from a maze_server on a temporary socket and times each request
+ kind on a miss (a new seed, so the maze is generated) and on a hit (the same
+ seed again, served from the cache).
+ return Number of requests that failed.
+ */
+int bench_serve(const std::vector<int> &sizes, maze_gen::storage_mode storage) {
+    const std::string path = "/tmp/maze_bench_" + std::to_string(getpid()) + ".sock";
+    maze_gen::server_options settings;
+    settings.workers = 1;
+    settings.storage = storage;
+    maze_gen::maze_server server(settings);
+    std::string error;
+    if (!server.listen(path, error)) {
+        std::fprintf(stderr, "Cannot serve: %s\n", error.c_str());
+        return 1;
+    }
+    std::thread serving([&] { server.run(); });
+    int failures = 0;
+    {
+        serve_client client(path);
+        failures += !client.ok();
+        std::printf("%-10s %-8s %6s %12s %12s %9s\n", "request", "size", "runs", "miss_ms", "hit_ms", "speedup");
+        uint64_t seed = 1;
+        for (int size : sizes) {
+            const int reps = int(std::max(1.0, std::min(200.0, 2e6 / (double(size) * size))));
+            for (const char *kind : {"GENERATE", "SOLVE", "REGION"}) {
+                auto line = [&](uint64_t s) {
+                    std::string res = std::string(kind) + " " + std::to_string(size) + " " + std::to_string(size) +
+                                      " backtracker " + std::to_string(s);
+                    return std::strcmp(kind, "REGION") ? res : res + " 0 0 41 81";
+                };
+                auto answered = [&](uint64_t s, const char *how) {
+                    return client.request(line(s)).find(how) != std::string::npos;
+                };
+                const uint64_t first = seed;
+                bool ok = true;
+                const measurement miss = measure([&] { ok = answered(seed++, " miss") && ok; }, reps);
+                const measurement hit = measure([&] { ok = answered(first, " hit") && ok; }, reps);
+                record("serve", kind, "miss", size, miss);
+                record("serve", kind, "hit", size, hit);
+                std::printf("%-10s %-8d %6d %12.3f %12.3f %8.1fx%s\n", kind, size, reps, miss.ms, hit.ms,
+                            miss.ms / hit.ms, ok ? "" : "  FAIL");
+                std::fflush(stdout);
+                failures += !ok;
+            }
+        }
+        std::printf("cache: %s\n", client.request("STATS").c_str() + 3);
+    }
+    server.stop();
+    serving.join();
+    return failures;
+}
+
+/*
+ Toggles random inner walls of a maze and re-solves it after each edit, once
+ from the tracked distances and once with a full breadth-first search, checking
+ that both find paths of the same length.
+ return Number of edits where they disagree.
+ */
+int bench_edits(const std::vector<int> &sizes, maze_gen::storage_mode storage) {
+    std::printf("%-8s %6s %14s %14s %12s %9s\n", "size", "edits", "incr_ms/edit", "full_ms/edit", "cells/edit",
+                "speedup");
+    int failures = 0;
+    for (int size : sizes) {
+        maze_gen::maze_generator gen(size, size);
+        gen.set_verbose(false);
+        gen.set_storage(storage);
+        gen.set_algorithm(maze_gen::maze_algorithm::kruskal);
+        gen.set_seed(1);
+        gen.generate_maze();
+        gen.track_distances();
+        const maze_gen::maze &m = gen.get_maze();
+        const maze_gen::cell entrance(1, 1), exit(size - 2, size - 2);
+        maze_gen::maze_rng rng(7);
+        int edits = 0;
+        double incremental = 0, full = 0;
+        size_t touched = 0;
+        for (int attempt = 0; attempt < 2000; ++attempt) {
+            const maze_gen::cell c(unsigned(2 * rng.bounded(uint64_t(size - 1) / 2) + 1),
+                                   unsigned(2 * rng.bounded(uint64_t(size - 1) / 2) + 1));
+            const int dir = int(rng.bounded(4));
+            const int x = int(c.x) + maze_gen::dir_row[dir], y = int(c.y) + maze_gen::dir_col[dir];
+            if (x <= 0 || y <= 0 || x >= size - 1 || y >= size - 1)
+                continue; // The border
+            ++edits;
+            const bool wall = storage == maze_gen::storage_mode::compact ? m.packed.is_wall(x, y)
+                                                                         : m.grid(x, y) == WALL;
+            maze_gen::solve_result a, b;
+            incremental += time_ms([&] {
+                wall ? gen.open_wall(c, dir) : gen.close_wall(c, dir);
+                a = gen.find_path(maze_gen::solver_algorithm::bfs, entrance, exit);
+            });
+            touched += gen.get_distances().touched();
+            full += time_ms([&] {
+                b = storage == maze_gen::storage_mode::compact
+                        ? maze_gen::find_path(m.packed, maze_gen::solver_algorithm::bfs, entrance, exit)
+                        : maze_gen::find_path(maze_gen::grid_view(m.grid), maze_gen::solver_algorithm::bfs,
+                                              entrance, exit);
+            });
+            failures += a.found != b.found || a.path.size() != b.path.size();
+        }
+
+        // Every distance must also match a field built from scratch
+        maze_gen::distance_field fresh;
+        if (storage == maze_gen::storage_mode::compact)
+            fresh.build(m.packed);
+        else
+            fresh.build(maze_gen::grid_view(m.grid));
+        for (int i = 1; i < size - 1; i += 2)
+            for (int j = 1; j < size - 1; j += 2)
+                failures += fresh.distance(maze_gen::cell(i, j)) != gen.get_distances().distance(maze_gen::cell(i, j));
+
+        measurement mi, mf;
+        mi.ms = incremental / edits;
+        mf.ms = full / edits;
+        record("edits", "resolve", "incremental", size, mi);
+        record("edits", "resolve", "full", size, mf);
+        std::printf("%-8d %6d %14.4f %14.4f %12.1f %8.1fx%s\n", size, edits, mi.ms, mf.ms, double(touched) / edits,
+                    mf.ms / mi.ms, failures ? "  MISMATCH" : "");
+        std::fflush(stdout);
+    }
+    return failures;
+}
+
+/*
+ Backtracker throughput of the 2D generator next to the N-dimensional lattice
+ at N = 2 and N = 3 (levels floors of the same size), plus solving and a
+ save/load round trip of the layered maze.
+ return Number of checks that failed.
+ */
+int bench_layers(const std::vector<int> &sizes, int levels, maze_gen::storage_mode storage) {
+    std::printf("%-16s %-8s %6s %12s %12s %10s\n", "maze", "size", "levels", "cells", "ms", "ns/cell");
+    const std::string path = "maze_bench_" + std::to_string(getpid()) + ".mazn";
+    int failures = 0;
+    auto report = [&](const char *what, int size, int floors, double cells, const measurement &m, bool ok) {
+        record("layers", what, std::to_string(floors), size, m);
+        std::printf("%-16s %-8d %6d %12.0f %12.2f %10.1f%s\n", what, size, floors, cells, m.ms, m.ms * 1e6 / cells,
+                    ok ? "" : "  FAIL");
+        std::fflush(stdout);
+        failures += !ok;
+    };
+    for (int size : sizes) {
+        const int side = (size - 1) / 2;
+        const double cells = double(side) * side;
+
+        maze_gen::maze_generator gen(size, size);
+        gen.set_verbose(false);
+        gen.set_storage(storage);
+        gen.set_seed(1);
+        gen.generate_maze(); // Buffers exist before timing, as in a batch
+        report("2d generator", size, 1, cells, measure([&] { gen.generate_maze(); }), true);
+
+        maze_gen::lattice<2> flat;
+        flat.assign({side, side});
+        flat.generate(1);
+        const measurement m2 = measure([&] { flat.generate(1); });
+        // The same maze in compact storage must solve to the same path length
+        const maze_gen::lattice_path flat_path = flat.solve();
+        const maze_gen::solve_result compact_path = maze_gen::find_path(
+            maze_gen::to_compact(flat), maze_gen::solver_algorithm::bfs, maze_gen::cell(1, 1),
+            maze_gen::cell(size - 2, size - 2));
+        report("lattice<2>", size, 1, cells, m2, flat_path.found && compact_path.path.size() == flat_path.cells.size());
+
+        maze_gen::lattice<3> layered;
+        layered.assign({levels, side, side});
+        const double cells3 = cells * levels;
+        report("lattice<3>", size, levels, cells3, measure([&] { layered.generate(1); }), true);
+        maze_gen::lattice_path solved;
+        const measurement solve = measure([&] { solved = layered.solve(); });
+        report("lattice<3> solve", size, levels, cells3, solve, solved.found);
+
+        std::string error;
+        bool saved = false, loaded = false;
+        maze_gen::lattice<3> copy;
+        const measurement save = measure([&] { saved = layered.save(path, error); });
+        report("lattice<3> save", size, levels, cells3, save, saved);
+        const measurement load = measure([&] { loaded = copy.load(path, error); });
+        report("lattice<3> load", size, levels, cells3, load,
+               loaded && copy.dims() == layered.dims() && copy.solve().cells == solved.cells);
+        if (!error.empty())
+            std::fprintf(stderr, "%s\n", error.c_str());
+        std::remove(path.c_str());
+    }
+    return failures;
+}
+
+/*
+ Scaling curve of the parallel breadth-first solver across thread counts, next to
+ the sequential bfs solver on the same maze: a perfect Kruskal maze, then the same
+ maze braided by opening a quarter as many random walls as it has cells. Loops
+ widen the frontier; avg_frontier (cells expanded per level) bounds how much of a
+ level there is to split. Every path must be as long as the bfs one.
+ return Number of mismatched paths.
+ */
+int bench_pbfs(const std::vector<int> &sizes, const std::vector<int> &thread_counts, maze_gen::storage_mode storage) {
+    std::printf("%-8s %-8s %-10s %8s %12s %12s %9s %10s\n", "size", "maze", "solver", "threads", "ms",
+                "avg_frontier", "speedup", "path");
+    int failures = 0;
+    for (int size : sizes)
+        for (const char *kind : {"perfect", "braided"}) {
+            maze_gen::maze_generator gen(size, size);
+            gen.set_verbose(false);
+            gen.set_storage(storage);
+            gen.set_algorithm(maze_gen::maze_algorithm::kruskal);
+            gen.set_seed(1);
+            gen.generate_maze();
+            const uint64_t side = uint64_t(size - 1) / 2;
+            maze_gen::maze_rng rng(7);
+            for (uint64_t i = 0; kind[0] == 'b' && i < side * side / 4; ++i)
+                gen.open_wall(
+                    maze_gen::cell(unsigned(2 * rng.bounded(side) + 1), unsigned(2 * rng.bounded(side) + 1)),
+                    int(rng.bounded(4)));
+            const maze_gen::cell entrance(1, 1), exit(size - 2, size - 2);
+
+            maze_gen::solve_result base;
+            const measurement mb =
+                measure([&] { base = gen.find_path(maze_gen::solver_algorithm::bfs, entrance, exit); });
+            record("pbfs", std::string("solve ") + kind, "bfs", size, mb);
+            const double levels = double(std::max<size_t>(1, base.path.size()));
+            std::printf("%-8d %-8s %-10s %8d %12.2f %12.1f %8.2fx %10zu\n", size, kind, "bfs", 1, mb.ms,
+                        base.stats.nodes_expanded / levels, 1.0, base.path.size());
+            for (int threads : thread_counts) {
+                gen.set_threads(threads);
+                maze_gen::solve_result res;
+                const measurement m =
+                    measure([&] { res = gen.find_path(maze_gen::solver_algorithm::parallel, entrance, exit); });
+                record("pbfs", std::string("solve ") + kind, "parallel-" + std::to_string(threads), size, m);
+                const bool ok = res.found == base.found && res.path.size() == base.path.size();
+                failures += !ok;
+                std::printf("%-8d %-8s %-10s %8d %12.2f %12.1f %8.2fx %10zu%s\n", size, kind, "parallel", threads,
+                            m.ms, res.stats.nodes_expanded / levels, mb.ms / m.ms, res.path.size(),
+                            ok ? "" : "  MISMATCH");
+                std::fflush(stdout);
+            }
+        }
+    return failures;
+}
+
+/*
+ Renders a solved maze as text and as every image format at each thread count,
+ into a stream that only counts bytes. peak_heap_kb shows the memory of the
+ bands, which stays flat as mazes grow. A corner of each image is read back and
+ compared with the maze and its path.
+ return Number of images that did not match.
+ */
+int bench_image(const std::vector<int> &sizes, const std::vector<int> &thread_counts, maze_gen::storage_mode storage) {
+    std::printf("%-8s %-6s %8s %12s %12s %12s\n", "size", "format", "threads", "ms", "MB", "peak_heap_kb");
+    int failures = 0;
+    for (int size : sizes) {
+        maze_gen::maze_generator gen(size, size);
+        gen.set_verbose(false);
+        gen.set_storage(storage);
+        gen.set_seed(1);
+        gen.generate_maze();
+        const maze_gen::maze &m = gen.get_maze();
+        const maze_gen::solve_result solved =
+            gen.find_path(maze_gen::solver_algorithm::bfs, maze_gen::cell(1, 1), maze_gen::cell(size - 2, size - 2));
+        maze_gen::compact_walls path;
+        path.assign(size, size);
+        maze_gen::trace_path(solved.path, path);
+        auto draw = [&](std::ostream &out, const maze_gen::image_options &opts) {
+            return storage == maze_gen::storage_mode::compact
+                       ? maze_gen::write_image(out, m.packed, &path, opts)
+                       : maze_gen::write_image(out, maze_gen::grid_view(m.grid), &path, opts);
+        };
+
+        null_buffer text;
+        std::ostream text_out(&text);
+        const measurement mt = measure([&] {
+            maze_gen::text_sink sink(text_out);
+            gen.write_rows(sink);
+        });
+        record("image", "render", "text", size, mt);
+        std::printf("%-8d %-6s %8d %12.2f %12.1f %12zu\n", size, "text", 1, mt.ms, text.bytes / 1e6,
+                    mt.peak_heap / 1024);
+
+        for (maze_gen::image_format format :
+             {maze_gen::image_format::pbm, maze_gen::image_format::pgm, maze_gen::image_format::png}) {
+            // Pixels of the top left corner in PGM, where each shade stands apart
+            maze_gen::image_options corner;
+            corner.format = maze_gen::image_format::pgm;
+            corner.rows = corner.cols = 101;
+            corner.threads = 2;
+            corner.band_rows = 16;
+            std::ostringstream pgm;
+            draw(pgm, corner);
+            const int side = std::min(size, 101);
+            std::vector<char> on_path(size_t(side) * side, 0);
+            for (size_t i = 0; i < solved.path.size(); ++i) {
+                const maze_gen::cell &a = solved.path[i], &b = solved.path[i ? i - 1 : 0];
+                for (const maze_gen::cell &c : {a, maze_gen::cell((a.x + b.x) / 2, (a.y + b.y) / 2)})
+                    if (c.x < unsigned(side) && c.y < unsigned(side))
+                        on_path[size_t(c.x) * side + c.y] = 1;
+            }
+            const std::string pixels = pgm.str().substr(pgm.str().size() - size_t(side) * side);
+            bool ok = true;
+            for (int x = 0; x < side; ++x)
+                for (int y = 0; y < side; ++y) {
+                    const bool wall = m.packed.empty() ? m.grid(x, y) == WALL : m.packed.is_wall(x, y);
+                    const unsigned char expect = wall ? 0 : on_path[size_t(x) * side + y] ? 128 : 255;
+                    ok = ok && (unsigned char)pixels[size_t(x) * side + y] == expect;
+                }
+            for (int threads : thread_counts) {
+                maze_gen::image_options opts;
+                opts.format = format;
+                opts.threads = threads;
+                null_buffer image;
+                std::ostream out(&image);
+                const measurement mi = measure([&] { ok = draw(out, opts) && ok; });
+                record("image", "render", std::string(maze_gen::image_format_name(format)) + "-" +
+                                              std::to_string(threads), size, mi);
+                std::printf("%-8d %-6s %8d %12.2f %12.1f %12zu%s\n", size, maze_gen::image_format_name(format),
+                            threads, mi.ms, image.bytes / 1e6, mi.peak_heap / 1024, ok ? "" : "  MISMATCH");
+                std::fflush(stdout);
+            }
+            failures += !ok;
+        }
+    }
+    return failures;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    std::vector<int> sizes;
+    int legacy_max = 8001; // Largest size the reference loop is run at
+    maze_gen::storage_mode storage = maze_gen::storage_mode::compact;
+    std::string suite = "all";
+    std::string json;
+    int levels = 8;
+    std::vector<int> thread_counts{1, 2, 4, 8};
+
+    int i = 1;
+    if (i < argc && argv[i][0] != '-')
+        suite = argv[i++];
+    for (; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--sizes") && i + 1 < argc)
+            sizes = parse_sizes(argv[++i]);
+        else if (!std::strcmp(argv[i], "--legacy-max") && i + 1 < argc)
+            legacy_max = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--levels") && i + 1 < argc)
+            levels = std::max(1, std::atoi(argv[++i]));
+        else if (!std::strcmp(argv[i], "--threads") && i + 1 < argc)
+            thread_counts = parse_sizes(argv[++i]);
+        else if (!std::strcmp(argv[i], "--json") && i + 1 < argc)
+            json = argv[++i];
+        else if (!std::strcmp(argv[i], "--storage") && i + 1 < argc)
+            storage = !std::strcmp(argv[++i], "bytes") ? maze_gen::storage_mode::bytes : maze_gen::storage_mode::compact;
+        else {
+            std::fprintf(stderr,
+                         "Usage: %s [carve|algos|allocs|simd|ops|serve|edits|layers|pbfs|image] [--sizes 101,201,...] "
+                         "[--legacy-max N] [--storage bytes|compact] [--levels N] [--threads 1,2,4,...] [--json PATH]\n",
+                         argv[0]);
+            return 1;
+        }
+    }
+
+    if (suite == "all" || suite == "carve")
+        bench_carve(sizes.empty() ? std::vector<int>{101, 201, 401, 1001, 2001, 4001, 8001} : sizes, legacy_max);
+    if (suite == "all" || suite == "algos")
+        bench_algos(sizes.empty() ? std::vector<int>{101, 1001, 4001} : sizes, storage);
+    int failures = 0;
+    if (suite == "all" || suite == "allocs")
+        failures = bench_allocs(sizes.empty() ? std::vector<int>{101, 1001, 4001} : sizes);
+    if (suite == "all" || suite == "simd")
+        failures += bench_simd(sizes.empty() ? std::vector<int>{101, 1001, 4001} : sizes);
+    if (suite == "ops")
+        failures += bench_ops(sizes.empty() ? std::vector<int>{101, 501, 1001, 2001} : sizes, storage);
+    if (suite == "serve")
+        failures += bench_serve(sizes.empty() ? std::vector<int>{101, 501, 1001, 2001} : sizes, storage);
+    if (suite == "edits")
+        failures += bench_edits(sizes.empty() ? std::vector<int>{101, 501, 1001, 2001} : sizes, storage);
+    if (suite == "layers")
+        failures += bench_layers(sizes.empty() ? std::vector<int>{101, 501, 1001} : sizes, levels, storage);
+    if (suite == "pbfs")
+        failures += bench_pbfs(sizes.empty() ? std::vector<int>{1001, 2001, 4001} : sizes, thread_counts, storage);
+    if (suite == "image")
+        failures += bench_image(sizes.empty() ? std::vector<int>{1001, 4001, 10001} : sizes, thread_counts, storage);
+    if (!json.empty() && !write_json(json, storage)) {
+        std::fprintf(stderr, "Could not write %s\n", json.c_str());
+        return 1;
+    }
+    return failures ? 1 : 0;
+}
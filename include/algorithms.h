@@ -0,0 +1,58 @@
+#pragma once
+#include <carve.h>
+#include <string>
+#include <vector>
+
+namespace maze_gen{
+    // Maze generation algorithms selectable with maze_generator::set_algorithm
+    enum class maze_algorithm{
+        backtracker, // Depth-first backtracking, long winding corridors
+        kruskal,     // Random edge order with union-find
+        prim,        // Randomized Prim, grows from a frontier, many short dead ends
+        eller,       // Row by row, keeps one row of state
+        wilson,      // Loop-erased random walks, uniform spanning tree
+        binary_tree, // Each cell opens north or west, no state at all
+        sidewinder   // Row runs closed upward, one row of state
+    };
+
+    /*
+     Strategy for carving a perfect maze (spanning tree) over a region of a
+     target whose passages are all closed. Only passages between cells of the
+     region are opened, which lets tiled generation run strategies per tile.
+     */
+    class maze_strategy{
+        public:
+            virtual ~maze_strategy() = default;
+            virtual maze_algorithm id()const = 0;
+            virtual void carve(carve_target& target, const cell_region& region, maze_rng& rng)const = 0;
+    };
+
+    const maze_strategy& strategy_for(maze_algorithm algo);
+    const char* algorithm_name(maze_algorithm algo);
+    bool parse_algorithm(const std::string& name, maze_algorithm& algo);
+    std::vector<maze_algorithm> all_algorithms();
+
+    /*
+     Eller's algorithm as a row source. Only the set labels of the current row
+     are kept, so a maze of any height can be produced in O(cols) memory.
+     */
+    class eller_rows{
+        private:
+            int cols_;
+            std::vector<int> sets_;   // Set label per cell of the current row, in [0, cols)
+            std::vector<int> parent_; // Union-find over the labels of the current row
+            std::vector<int> remap_, order_, start_;
+
+            int find(int a);
+        public:
+            explicit eller_rows(int cols);
+
+            /*
+             Produces the passages of the next row: links[c] gets compact_walls::east if
+             (r, c) opens to (r, c + 1) and compact_walls::south if it opens to (r + 1, c).
+             The last row joins every remaining set and opens nothing to the south.
+             */
+            void next(maze_rng& rng, bool last, unsigned char* links);
+            int cols()const{ return cols_; }
+    };
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <grid.h>
+#include <ostream>
+#include <vector>
+#include <cstddef>
+
+namespace maze_gen{
+    /*
+     Structure of a maze, measured over its cell graph (logical cells joined by
+     open passages). Corridors are the runs of cells with exactly two passages
+     between two cells that have any other number; their length counts passages.
+     */
+    struct maze_analysis{
+        size_t cells;
+        size_t passages;
+        size_t degree[5];            // Cells by number of open passages, 0 to 4
+        size_t dead_ends;            // Cells with one passage
+        size_t junctions;            // Cells with three or four passages
+        double branching_factor;     // Mean choices onward (passages - 1) at a junction
+        std::vector<size_t> corridors; // Bucket k counts corridors of length [2^k, 2^(k+1))
+        size_t longest_corridor;
+        size_t solution_length;      // Cells on the path from entrance to exit, 0 if there is none
+        size_t solution_decisions;   // Junctions on that path
+        size_t diameter;             // Cells on the longest shortest path between any two cells, as solution_length
+        cell diameter_from, diameter_to;
+        /*
+         0 to 100: 40 * junctions per solution cell + 30 * min(1, 2 * dead ends per cell)
+         + 30 * (1 - 1 / tortuosity), where tortuosity is the solution length over the
+         Manhattan distance between entrance and exit.
+         */
+        double difficulty;
+        double elapsed_ms;
+
+        maze_analysis() : cells(0), passages(0), degree{0, 0, 0, 0, 0}, dead_ends(0), junctions(0),
+                          branching_factor(0), longest_corridor(0), solution_length(0), solution_decisions(0),
+                          diameter(0), difficulty(0), elapsed_ms(0) {};
+    };
+
+    /*
+     Analyzes a maze view in linear time: one pass over the cells for degrees and
+     corridors, split over threads in row bands, then two breadth-first passes,
+     one from the entrance (solution and the farthest cell) and one from that
+     cell (the diameter, exact for perfect mazes). The breadth-first passes
+     split wide levels over threads as the parallel solver does; the results
+     are the same for any number of threads.
+     View is grid_view, compact_walls or mapped_maze.
+     */
+    template <typename View>
+    maze_analysis analyze_maze(const View& maze, int threads = 1);
+
+    void write_text(std::ostream& out, const maze_analysis& a);
+    void write_json(std::ostream& out, const maze_analysis& a);
+}
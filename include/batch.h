@@ -0,0 +1,91 @@
+#pragma once
+#include <algorithms.h>
+#include <solver.h>
+#include <analysis.h>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+namespace maze_gen{
+    class maze_generator;
+
+    // One maze of a batch. The seed fully determines the maze, whichever worker builds it.
+    struct batch_job{
+        int width, height;
+        maze_algorithm algo;
+        uint64_t seed;
+        bool solve;
+        solver_algorithm solver;
+        size_t queries;        // Random cell-to-cell distance queries answered from a path index, 0 for none
+        bool analyze;          // Run analyze() on the maze
+
+        batch_job() : width(0), height(0), algo(maze_algorithm::backtracker), seed(0), solve(false),
+                      solver(solver_algorithm::bfs), queries(0), analyze(false) {};
+        batch_job(int w, int h, maze_algorithm a, uint64_t s) : width(w), height(h), algo(a), seed(s), solve(false),
+                                                               solver(solver_algorithm::bfs), queries(0), analyze(false) {};
+    };
+
+    struct batch_result{
+        bool ok;               // False if the path index failed or the consumer rejected the maze
+        bool solved;
+        size_t path_cells, nodes_expanded;
+        double generate_ms, solve_ms, consume_ms;
+        double index_ms, query_ms;   // Building the path index, answering all queries
+        uint64_t distance_sum;       // Sum of the query distances, to compare runs
+        maze_analysis analysis;
+        int worker;
+
+        batch_result() : ok(true), solved(false), path_cells(0), nodes_expanded(0), generate_ms(0), solve_ms(0),
+                         consume_ms(0), index_ms(0), query_ms(0), distance_sum(0), worker(0) {};
+    };
+
+    struct batch_stats{
+        size_t mazes, cells, failures;
+        double elapsed_ms;
+        double mazes_per_sec, cells_per_sec;
+
+        batch_stats() : mazes(0), cells(0), failures(0), elapsed_ms(0), mazes_per_sec(0), cells_per_sec(0) {};
+    };
+
+    /*
+     Receives each finished maze on the worker that built it, while the maze is still in
+     that worker's generator. Called concurrently from several workers.
+     */
+    class batch_consumer{
+        public:
+            virtual ~batch_consumer() = default;
+            // Returns false to count the maze as failed.
+            virtual bool consume(size_t index, const batch_job& job, maze_generator& generator) = 0;
+    };
+
+    /*
+     Generates many mazes on a pool of workers. Each worker owns one maze_generator for
+     the lifetime of the batch object; its grid, visited plane, packed storage and carving
+     stack are recycled from maze to maze, so after the largest size has been seen a
+     worker allocates nothing per maze beyond what the algorithm itself needs.
+     */
+    class maze_batch{
+        private:
+            int workers_;
+            storage_mode storage_;
+            int tile_cells_;
+            bool compress_;
+            std::vector<std::unique_ptr<maze_generator>> generators_;
+        public:
+            explicit maze_batch(int workers, storage_mode storage = storage_mode::bytes);
+            ~maze_batch();
+
+            void set_tile_size(int cells);
+            void set_tile_threads(int n);
+            void set_compression(bool enabled);
+            int workers()const{ return workers_; }
+
+            /*
+             Builds every job. results is resized to jobs.size() and filled by job index,
+             so the output order never depends on scheduling.
+             */
+            batch_stats run(const std::vector<batch_job>& jobs, std::vector<batch_result>& results,
+                            batch_consumer* consumer = nullptr);
+    };
+}
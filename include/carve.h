@@ -0,0 +1,94 @@
+#pragma once
+#include <grid.h>
+#include <compact.h>
+#include <rng.h>
+#include <vector>
+#include <numeric>
+#include <cstdint>
+
+namespace maze_gen{
+    class maze_strategy;
+
+    // Rectangle of logical cells [r0, r1) x [c0, c1)
+    struct cell_region{
+        int r0, c0, r1, c1;
+    };
+
+    /*
+     Write access to the passages of a maze under construction, in logical
+     cell coordinates (cell (r, c) is grid position (2r + 1, 2c + 1)).
+     Backs onto either the byte grid or compact storage so carving code is
+     written once for both.
+     */
+    class carve_target{
+        private:
+            grid2d<char>* grid_;
+            compact_walls* packed_;
+            int rows_, cols_;
+        public:
+            explicit carve_target(grid2d<char>& grid)
+                : grid_(&grid), packed_(nullptr), rows_((grid.rows() - 1) / 2), cols_((grid.cols() - 1) / 2) {};
+            explicit carve_target(compact_walls& walls)
+                : grid_(nullptr), packed_(&walls), rows_(walls.rows()), cols_(walls.cols()) {};
+
+            // Opens the passage from cell (r, c) in direction dir (see dir_row/dir_col).
+            void carve(int r, int c, int dir){
+                if (packed_)
+                    packed_->carve(r, c, dir);
+                else
+                    (*grid_)(2 * r + 1 + dir_row[dir], 2 * c + 1 + dir_col[dir]) = ' '; // CELL
+            }
+
+            int rows()const{ return rows_; }
+            int cols()const{ return cols_; }
+            bool is_compact()const{ return packed_ != nullptr; }
+    };
+
+    // Disjoint-set forest with path halving.
+    struct union_find{
+        std::vector<int> parent;
+
+        explicit union_find(size_t n) : parent(n) { std::iota(parent.begin(), parent.end(), 0); };
+
+        int find(int a){
+            while (parent[a] != a)
+                a = parent[a] = parent[parent[a]];
+            return a;
+        }
+        // Merges the sets of a and b; returns false if they were already one set.
+        bool unite(int a, int b){
+            a = find(a);
+            b = find(b);
+            if (a == b)
+                return false;
+            parent[a] = b;
+            return true;
+        }
+    };
+
+    // Directions set in a 4-bit mask (bit d for direction d), in increasing order.
+    struct direction_set{
+        unsigned char count;
+        unsigned char dir[4];
+    };
+    // Indexed by mask; picking dir[rng.bounded(count)] chooses among open options without branching on them.
+    extern const direction_set direction_sets[16];
+
+    // Derives an independent, well-mixed seed for a numbered stream (splitmix64).
+    uint64_t mix_seed(uint64_t seed, uint64_t stream);
+
+    /*
+     Depth-first backtracking over one region, carving a spanning tree of its cells.
+     Uses a 2-bit parent direction per cell in place of a stack.
+     */
+    void carve_backtracker(carve_target& target, const cell_region& region, maze_rng& rng);
+
+    /*
+     Splits the maze into square tiles of tile_cells x tile_cells logical cells, carves
+     each tile with the given strategy on a pool of worker threads and joins the tiles with a random spanning
+     tree of boundary passages, so the result is still a perfect maze.
+     tile_cells is rounded up to a multiple of 32 so compact tiles never share a word.
+     The output depends only on seed and tile_cells, not on the thread count.
+     */
+    void carve_tiled(carve_target& target, const maze_strategy& strategy, uint64_t seed, int tile_cells, int threads);
+}
@@ -0,0 +1,4 @@
+#pragma once
+namespace cli_logic{
+    int run(int argc, char** argv);
+}
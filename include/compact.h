@@ -0,0 +1,156 @@
+#pragma once
+#include <grid.h>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+
+namespace maze_gen{
+    // Steps between logical cells: 0 north, 1 east, 2 south, 3 west. The opposite of d is d ^ 2.
+    inline constexpr int dir_row[4] = {-1, 0, 1, 0};
+    inline constexpr int dir_col[4] = {0, 1, 0, -1};
+
+    // Open passages of logical cell (r, c) of a maze view as a mask, bit d for direction d.
+    template <typename View>
+    unsigned open_mask(const View& maze, int r, int c, int rows, int cols){
+        return unsigned(r > 0 && !maze.is_wall(2 * r, 2 * c + 1)) |
+               unsigned(c + 1 < cols && !maze.is_wall(2 * r + 1, 2 * c + 2)) << 1 |
+               unsigned(r + 1 < rows && !maze.is_wall(2 * r + 2, 2 * c + 1)) << 2 |
+               unsigned(c > 0 && !maze.is_wall(2 * r + 1, 2 * c)) << 3;
+    }
+
+    /*
+     Packed 2D array of small fields (1, 2 or 4 bits each) stored in 64-bit words.
+     Every row starts on a word boundary so rows can be addressed, copied and
+     written independently.
+     */
+    class bit_plane{
+        private:
+            int rows_, cols_;
+            unsigned bits_;
+            uint64_t mask_;
+            size_t row_words_;
+            std::vector<uint64_t> words_;
+        public:
+            bit_plane() : rows_(0), cols_(0), bits_(1), mask_(1), row_words_(0) {};
+
+            // Resizes the plane to rows x cols fields of the given width and clears every field.
+            void assign(int rows, int cols, unsigned bits){
+                rows_ = rows;
+                cols_ = cols;
+                bits_ = bits;
+                mask_ = (uint64_t(1) << bits) - 1;
+                row_words_ = (size_t(cols) * bits + 63) / 64;
+                words_.assign(row_words_ * rows, 0);
+            }
+            void clear(){ std::fill(words_.begin(), words_.end(), 0); }
+
+            unsigned get(int r, int c)const{
+                size_t bit = size_t(c) * bits_;
+                return unsigned(words_[size_t(r) * row_words_ + bit / 64] >> (bit % 64)) & mask_;
+            }
+            void set(int r, int c, unsigned value){
+                size_t bit = size_t(c) * bits_;
+                uint64_t &w = words_[size_t(r) * row_words_ + bit / 64];
+                w = (w & ~(mask_ << (bit % 64))) | (uint64_t(value & mask_) << (bit % 64));
+            }
+            void set_bits(int r, int c, unsigned value){
+                size_t bit = size_t(c) * bits_;
+                words_[size_t(r) * row_words_ + bit / 64] |= uint64_t(value & mask_) << (bit % 64);
+            }
+
+            uint64_t* row_words(int r){ return words_.data() + size_t(r) * row_words_; }
+            const uint64_t* row_words(int r)const{ return words_.data() + size_t(r) * row_words_; }
+            size_t words_per_row()const{ return row_words_; }
+            size_t bytes()const{ return words_.size() * sizeof(uint64_t); }
+            int rows()const{ return rows_; }
+            int cols()const{ return cols_; }
+            bool empty()const{ return words_.empty(); }
+    };
+
+    // How a maze is held in memory
+    enum class storage_mode{
+        bytes,   // One char per grid position in maze::grid
+        compact  // Two passage bits per cell in maze::packed
+    };
+
+    /*
+     Compact maze storage: two bits per logical cell recording whether the
+     passage to the east and to the south is open. Cell positions (odd, odd),
+     wall corners (even, even) and the outer border are implied, with the
+     entrance at (0, 1) and the exit at (height - 1, width - 2).
+     Logical cell (r, c) sits at grid position (2r + 1, 2c + 1).
+     */
+    class compact_walls{
+        private:
+            int height_, width_; // Grid positions, as in maze::grid
+            bit_plane bits_;
+        public:
+            enum : unsigned { east = 1, south = 2 };
+
+            compact_walls() : height_(0), width_(0) {};
+
+            // Resizes to a height x width grid with every passage closed.
+            void assign(int height, int width){
+                height_ = height;
+                width_ = width;
+                bits_.assign((height - 1) / 2, (width - 1) / 2, 2);
+            }
+            void clear(){ height_ = width_ = 0; bits_ = bit_plane(); }
+
+            unsigned get(int r, int c)const{ return bits_.get(r, c); }
+            void open(int r, int c, unsigned which){ bits_.set_bits(r, c, which); }
+            void close(int r, int c, unsigned which){ bits_.set(r, c, bits_.get(r, c) & ~which); }
+
+            // True if the passage from logical cell (r, c) in direction dir is open.
+            bool passage(int r, int c, int dir)const{
+                switch (dir) {
+                case 0: return r > 0 && (get(r - 1, c) & south);
+                case 1: return get(r, c) & east;
+                case 2: return get(r, c) & south;
+                default: return c > 0 && (get(r, c - 1) & east);
+                }
+            }
+            // Opens the passage from logical cell (r, c) in direction dir.
+            void carve(int r, int c, int dir){
+                switch (dir) {
+                case 0: open(r - 1, c, south); break;
+                case 1: open(r, c, east); break;
+                case 2: open(r, c, south); break;
+                default: open(r, c - 1, east); break;
+                }
+            }
+
+            // Grid-position query equivalent to maze::grid(x, y) == WALL.
+            bool is_wall(int x, int y)const{
+                if (x <= 0 || y <= 0 || x >= height_ - 1 || y >= width_ - 1)
+                    return !((x == 0 && y == 1) || (x == height_ - 1 && y == width_ - 2));
+                if (x & 1) {
+                    if (y & 1) return false;                            // Cell
+                    return !(get(x >> 1, (y >> 1) - 1) & east);         // Passage between (x, y - 1) and (x, y + 1)
+                }
+                if (y & 1) return !(get((x >> 1) - 1, y >> 1) & south); // Passage between (x - 1, y) and (x + 1, y)
+                return true;                                            // Corner
+            }
+
+            void expand_row(int x, char *out)const;
+            void pack_row(int x, const char *in);
+
+            bit_plane& plane(){ return bits_; }
+            const bit_plane& plane()const{ return bits_; }
+            int height()const{ return height_; }
+            int width()const{ return width_; }
+            int rows()const{ return bits_.rows(); }
+            int cols()const{ return bits_.cols(); }
+            size_t bytes()const{ return bits_.bytes(); }
+            bool empty()const{ return bits_.empty(); }
+    };
+
+    /*
+     A compact_walls of the maze size can hold a path instead of a maze: the passages
+     it opens are the steps of the path. trace_path records a path of adjacent cells
+     (grid positions) that way and mark_path_row draws it over an expanded grid row.
+     */
+    void trace_path(const std::vector<cell>& path, compact_walls& overlay);
+    void mark_path_row(const compact_walls& overlay, int x, char* row);
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <grid.h>
+#include <solver.h>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/*
+ Distance index sidecar file, version 1. All integers are little-endian.
+
+   offset  size  field
+   0       4     magic "MAZI"
+   4       2     version (1)
+   6       2     flags (0)
+   8       4     height, grid positions
+   12      4     width, grid positions
+   16      4     fingerprint: CRC-32 of the maze passages (see maze_fingerprint)
+   20      4     cells n
+   24      4n    parent of each cell, the root pointing at itself
+   ...     4n    depth of each cell
+   ...     4n    head of the heavy path of each cell
+   ...     4     CRC-32 of the three arrays
+
+ The file is written next to the maze as <maze file>.idx and only used when its
+ fingerprint matches the maze it is loaded for.
+ */
+
+namespace maze_gen{
+    constexpr char INDEX_MAGIC[4] = {'M', 'A', 'Z', 'I'};
+    constexpr uint16_t INDEX_VERSION = 1;
+
+    /*
+     CRC-32 of the open east and south passages of every cell, one byte per cell.
+     Identifies a maze independently of how it is stored.
+     */
+    template <typename View>
+    uint32_t maze_fingerprint(const View& maze);
+
+    /*
+     Answers distance and path queries between any two cells of a perfect maze.
+     A perfect maze is a tree, so the path between two cells runs through their
+     lowest common ancestor. The tree is rooted at the entrance cell and split
+     into heavy paths (heavy-light decomposition): any cell reaches the root
+     through O(log n) paths, so the ancestor is found in O(log n) steps from
+     three arrays of 4 bytes per cell. Building is one breadth-first pass.
+     */
+    class distance_index{
+        private:
+            int height_, width_;
+            int cols_;
+            uint32_t fingerprint_;
+            std::vector<uint32_t> parent_, depth_, head_;
+
+            uint32_t id_of(const cell& c)const{ return (c.x / 2) * uint32_t(cols_) + c.y / 2; }
+            cell cell_of(uint32_t id)const{ return cell(2 * (id / cols_) + 1, 2 * (id % cols_) + 1); }
+            bool contains(const cell& c)const;
+            uint32_t ancestor(uint32_t a, uint32_t b)const;
+        public:
+            static const size_t npos = size_t(-1);
+
+            distance_index() : height_(0), width_(0), cols_(0), fingerprint_(0) {};
+
+            // Builds the index; fails with a message when the maze has a loop or an unreachable cell.
+            template <typename View>
+            bool build(const View& maze, std::string& error);
+            void clear();
+            bool empty()const{ return parent_.empty(); }
+            int height()const{ return height_; }
+            int width()const{ return width_; }
+            uint32_t fingerprint()const{ return fingerprint_; }
+            size_t bytes()const{ return 3 * parent_.size() * sizeof(uint32_t); }
+
+            // Steps between two cell positions (odd coordinates), or npos if either is not a cell.
+            size_t distance(const cell& a, const cell& b)const;
+            // The path between two cells, in the form find_path returns; stats count the cells walked.
+            solve_result path(const cell& a, const cell& b)const;
+
+            bool save(const std::string& filename, std::string& error)const;
+            // Loads an index and rejects it unless it was built for a maze of the given size and
+            // fingerprint and forms a tree. A missing file fails with an empty error.
+            bool load(const std::string& filename, int height, int width, uint32_t fingerprint, std::string& error);
+    };
+}
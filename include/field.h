@@ -0,0 +1,62 @@
+#pragma once
+#include <grid.h>
+#include <solver.h>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace maze_gen{
+    /*
+     Distances of every cell from the entrance cell (1, 1), kept up to date while
+     walls are opened and closed. Unlike distance_index the maze may have loops.
+
+     Opening a wall lowers distances outward from the nearer side, visiting only
+     the cells that get closer. Closing one first finds the cells whose every
+     shortest route used it (in order of distance, a cell is lost when no
+     neighbor one step closer survives), then recomputes just those from the
+     cells around them. Either way an edit costs time in proportion to the cells
+     whose distance changes, and the path to any cell follows the distances down.
+     */
+    class distance_field{
+        private:
+            int height_, width_;
+            int rows_, cols_;
+            std::vector<unsigned char> open_;  // Open passages of each cell, bit d for direction d
+            std::vector<uint32_t> dist_;
+            std::vector<unsigned char> mark_;  // Scratch of close(), all zero between edits
+            std::vector<uint32_t> queue_, lost_;
+            size_t touched_;
+
+            uint32_t id_of(const cell& c)const{ return (c.x / 2) * uint32_t(cols_) + c.y / 2; }
+            cell cell_of(uint32_t id)const{ return cell(2 * (id / cols_) + 1, 2 * (id % cols_) + 1); }
+            uint32_t step(uint32_t v, int dir)const;
+            bool edge(const cell& c, int dir, uint32_t& v, uint32_t& u)const;
+        public:
+            static const size_t npos = size_t(-1);
+
+            distance_field() : height_(0), width_(0), rows_(0), cols_(0), touched_(0) {};
+
+            // Computes every distance with one breadth-first pass. View as for find_path.
+            template <typename View>
+            void build(const View& maze);
+            void clear();
+            bool empty()const{ return dist_.empty(); }
+            int height()const{ return height_; }
+            int width()const{ return width_; }
+
+            /*
+             Opens or closes the wall on side dir (0 north, 1 east, 2 south, 3 west) of a
+             cell position. Returns false, changing nothing, unless c is a cell and the
+             wall separates it from another cell.
+             */
+            bool open(const cell& c, int dir);
+            bool close(const cell& c, int dir);
+
+            // Steps from the entrance to a cell position, or npos if it is unreachable or not a cell.
+            size_t distance(const cell& c)const;
+            // Shortest path from the entrance, in the form find_path returns; costs its length.
+            solve_result path(const cell& goal)const;
+            // Cells the last edit examined, a measure of how far it reached.
+            size_t touched()const{ return touched_; }
+    };
+}
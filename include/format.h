@@ -0,0 +1,132 @@
+#pragma once
+#include <grid.h>
+#include <compact.h>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/*
+ Maze file format, version 2. All integers are little-endian.
+
+   offset  size  field
+   0       4     magic "MAZB"
+   4       2     version (2)
+   6       2     flags (format_flags)
+   8       4     height, grid positions
+   12      4     width, grid positions
+   16      4     rows per block
+   20      4     name length n
+   24      n     name, then zero padding to a multiple of 8
+   ...           blocks
+
+ Packed payload (default): each logical cell row is words_per_row 64-bit words
+ holding the 2-bit east/south passage fields of compact_walls, row-aligned
+ exactly like bit_plane. Raw payload (FLAG_RAW): each block holds grid rows of
+ one byte per position, for grids that do not follow the standard layout.
+
+ Each block is a u32 stored size (bit 31 set when run-length encoded), a u32
+ CRC-32 of the decoded bytes, then the stored bytes padded to a multiple of 8.
+ Uncompressed blocks therefore keep the payload 8-byte aligned in the file, and
+ files written without compression can be memory-mapped without decoding
+ (see mapped.h; compressed files are mapped too, decoding blocks on demand).
+
+ Files without the magic are read as the original format: host size_t name
+ length, name, host int height and width, one byte per grid position.
+ */
+
+namespace maze_gen{
+    enum format_flags : uint16_t{
+        FLAG_RAW = 1,   // Payload is raw grid bytes instead of packed passages
+        FLAG_STORED = 2 // No block is compressed, so every row is at a computable offset
+    };
+
+    constexpr char FORMAT_MAGIC[4] = {'M', 'A', 'Z', 'B'};
+    constexpr uint16_t FORMAT_VERSION = 2;
+    constexpr uint32_t BLOCK_RLE = 0x80000000u;
+    constexpr size_t FORMAT_HEADER_SIZE = 24;
+    constexpr uint64_t MAX_PAYLOAD_BYTES = uint64_t(1) << 38; // Largest grid or wall payload a file may declare
+
+    struct maze_header{
+        uint16_t version;
+        uint16_t flags;
+        uint32_t height, width;
+        uint32_t rows_per_block;
+        std::string name;
+        uint64_t payload_offset; // File offset of the first block
+
+        maze_header() : version(0), flags(0), height(0), width(0), rows_per_block(0), payload_offset(0) {};
+    };
+
+    // Little-endian fields of the file formats (maze, lattice and distance index files).
+    inline void put_u16(unsigned char* p, uint16_t v){
+        p[0] = v & 0xFF;
+        p[1] = v >> 8;
+    }
+    inline void put_u32(unsigned char* p, uint32_t v){
+        for (int i = 0; i < 4; ++i)
+            p[i] = (v >> (8 * i)) & 0xFF;
+    }
+    inline uint16_t get_u16(const unsigned char* p){
+        return uint16_t(p[0] | (p[1] << 8));
+    }
+    inline uint32_t get_u32(const unsigned char* p){
+        return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+    }
+
+    uint32_t crc32(const void* data, size_t size, uint32_t crc = 0);
+    void rle_encode(const unsigned char* data, size_t size, std::vector<unsigned char>& out);
+    bool rle_decode(const unsigned char* data, size_t size, unsigned char* out, size_t out_size);
+
+    // Bytes from the read position to the end of a seekable stream; UINT64_MAX if that cannot be told.
+    uint64_t stream_bytes_left(std::istream& in);
+
+    // True if a packed row of words_per_row words sets no bit the writer never sets: padding, the
+    // east passage of the last column or, on the last logical row, any south passage.
+    bool packed_row_valid(const uint64_t* words, size_t words_per_row, int cols, bool last_row);
+
+    // True if the grid has the layout compact_walls can represent exactly.
+    bool is_standard_layout(const grid2d<char>& grid);
+
+    /*
+     Writes a version 2 file block by block. Rows are appended one at a time, so
+     streaming generators can write without holding the maze.
+     */
+    class maze_writer{
+        private:
+            std::ostream& out_;
+            bool raw_;
+            size_t row_bytes_;
+            uint32_t rows_per_block_;
+            bool compress_;
+            std::vector<unsigned char> block_, encoded_;
+            uint32_t rows_in_block_;
+            uint64_t bytes_written_;
+
+            void flush_block();
+        public:
+            /*
+             Writes the header. raw selects one byte per grid position (rows of width
+             bytes); otherwise rows are packed logical rows of compact_walls words.
+             */
+            maze_writer(std::ostream& out, const std::string& name, int height, int width, bool raw, bool compress,
+                        uint32_t rows_per_block = 64);
+
+            void write_row(const void* row);
+            void finish();
+            uint64_t bytes_written()const{ return bytes_written_; }
+    };
+
+    // Reads the header of a version 2 file; false if the magic is missing or the header is invalid.
+    bool read_header(std::istream& in, maze_header& header, std::string& error);
+
+    /*
+     Reads the blocks after a version 2 header. Packed files fill walls; raw
+     files fill grid. Every block checksum is verified. The declared size is
+     checked against MAX_PAYLOAD_BYTES and the bytes left in the stream before
+     anything is allocated.
+     */
+    bool read_payload(std::istream& in, const maze_header& header, compact_walls& walls, grid2d<char>& grid,
+                      std::string& error, uint64_t* bytes_read = nullptr);
+}
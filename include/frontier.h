@@ -0,0 +1,120 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <type_traits>
+#include <cstddef>
+
+namespace maze_gen{
+    // Smallest frontier worth splitting across threads; waking the workers costs more than smaller levels.
+    constexpr size_t MIN_PARALLEL_FRONTIER = 1024;
+
+    /*
+     Drives a level-synchronous breadth-first search on up to threads threads.
+     Each step() expands one frontier: levels of MIN_PARALLEL_FRONTIER nodes or
+     more are split evenly, every thread expanding its share into a buffer of
+     its own, and the buffers become the next frontier in thread order. Smaller
+     levels run on the calling thread alone. Workers start at the first level
+     large enough and sleep between levels until the expander is destroyed.
+
+     The caller's expand(shared, first, end, out) appends what frontier[first,
+     end) reaches to out. shared is std::true_type while other threads expand
+     the same level, so claiming a node must then be atomic, and
+     std::false_type otherwise.
+     */
+    template <typename Node>
+    class level_expander{
+        private:
+            int threads_;
+            std::vector<std::vector<Node>> next_;
+            std::function<void(int)> job_; // Share of the current level for each thread
+            std::mutex lock_;
+            std::condition_variable wake_, done_;
+            size_t started_; // Number of parallel levels started
+            int pending_;    // Workers still expanding the current one
+            bool quit_;
+            std::vector<std::thread> pool_;
+
+            void work(int t);
+        public:
+            explicit level_expander(int threads)
+                : threads_(threads < 1 ? 1 : threads), next_(size_t(threads_)), started_(0), pending_(0),
+                  quit_(false) {};
+            ~level_expander();
+            level_expander(const level_expander&) = delete;
+            level_expander& operator=(const level_expander&) = delete;
+
+            // Expands frontier one level; false, leaving frontier as it was, if nothing new is reached.
+            template <typename Expand>
+            bool step(std::vector<Node>& frontier, Expand expand);
+    };
+
+    template <typename Node>
+    level_expander<Node>::~level_expander(){
+        {
+            std::lock_guard<std::mutex> hold(lock_);
+            quit_ = true;
+        }
+        wake_.notify_all();
+        for (std::thread& th : pool_)
+            th.join();
+    }
+
+    template <typename Node>
+    void level_expander<Node>::work(int t){
+        size_t ran = 0;
+        std::unique_lock<std::mutex> hold(lock_);
+        for (;;) {
+            wake_.wait(hold, [&] { return quit_ || started_ != ran; });
+            if (quit_)
+                return;
+            ran = started_;
+            hold.unlock();
+            job_(t);
+            hold.lock();
+            if (--pending_ == 0)
+                done_.notify_one();
+        }
+    }
+
+    template <typename Node>
+    template <typename Expand>
+    bool level_expander<Node>::step(std::vector<Node>& frontier, Expand expand){
+        if (threads_ == 1 || frontier.size() < MIN_PARALLEL_FRONTIER) {
+            expand(std::false_type(), size_t(0), frontier.size(), next_[0]);
+        } else {
+            auto share = [&](int t) {
+                const size_t n = frontier.size();
+                expand(std::true_type(), n * t / threads_, n * (t + 1) / threads_, next_[t]);
+            };
+            if (pool_.empty())
+                for (int t = 1; t < threads_; ++t)
+                    pool_.emplace_back(&level_expander::work, this, t);
+            {
+                std::lock_guard<std::mutex> hold(lock_);
+                job_ = share;
+                pending_ = threads_ - 1;
+                ++started_;
+            }
+            wake_.notify_all();
+            share(0);
+            std::unique_lock<std::mutex> hold(lock_);
+            done_.wait(hold, [&] { return pending_ == 0; });
+        }
+
+        size_t reached = 0;
+        for (const std::vector<Node>& buffer : next_)
+            reached += buffer.size();
+        if (reached == 0)
+            return false;
+        frontier.swap(next_[0]);
+        next_[0].clear();
+        for (int t = 1; t < threads_; ++t) {
+            frontier.insert(frontier.end(), next_[t].begin(), next_[t].end());
+            next_[t].clear();
+        }
+        return true;
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+
+namespace maze_gen{
+    // Grid position: x is the row, y the column
+    struct cell{
+        unsigned int x, y;
+    
+        cell() : x(0), y(0) {};
+        cell(unsigned int x, unsigned int y): x(x), y(y) {}
+    };
+
+    /*
+     Contiguous row-major 2D array. All rows live in one allocation and
+     position (r, c) is found at r * stride() + c, so neighbour lookups are
+     plain offsets instead of a pointer chase through per-row vectors.
+     */
+    template <typename T>
+    class grid2d{
+        private:
+            int rows_, cols_;
+            std::vector<T> data_;
+        public:
+            grid2d() : rows_(0), cols_(0) {};
+            grid2d(int rows, int cols, T value = T()) : rows_(rows), cols_(cols), data_(size_t(rows) * cols, value) {};
+
+            // Resizes the grid and sets every position to value, reusing the existing allocation when large enough.
+            void assign(int rows, int cols, T value = T()){
+                rows_ = rows;
+                cols_ = cols;
+                data_.assign(size_t(rows) * cols, value);
+            }
+            void fill(T value){ std::fill(data_.begin(), data_.end(), value); }
+            void clear(){ rows_ = cols_ = 0; data_.clear(); }
+
+            T& operator()(int r, int c){ return data_[index(r, c)]; }
+            const T& operator()(int r, int c)const{ return data_[index(r, c)]; }
+            T& operator[](size_t i){ return data_[i]; }
+            const T& operator[](size_t i)const{ return data_[i]; }
+
+            size_t index(int r, int c)const{ return size_t(r) * cols_ + c; }
+            T* row(int r){ return data_.data() + size_t(r) * cols_; }
+            const T* row(int r)const{ return data_.data() + size_t(r) * cols_; }
+            T* data(){ return data_.data(); }
+            const T* data()const{ return data_.data(); }
+
+            int rows()const{ return rows_; }
+            int cols()const{ return cols_; }
+            int stride()const{ return cols_; }
+            size_t size()const{ return data_.size(); }
+            bool empty()const{ return data_.empty(); }
+    };
+}
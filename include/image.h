@@ -0,0 +1,74 @@
+#pragma once
+#include <compact.h>
+#include <stream.h>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+/*
+ Image output. Every grid position becomes a square of scale x scale pixels:
+
+   pbm  P4 bitmap, 1 bit per pixel: walls black, passages and path white
+   pgm  P5 greymap, 1 byte per pixel: walls 0, passages 255, path 128
+   png  colour type 3 (palette) at 2 bits per pixel: walls black, passages
+        white, path red. The zlib stream is made of stored deflate blocks, so
+        no compression library is needed; one IDAT chunk is written per band.
+
+ Images are written top to bottom in bands of rows and never held whole.
+ */
+
+namespace maze_gen{
+    enum class image_format{ pbm, pgm, png };
+
+    const char* image_format_name(image_format format);
+    bool parse_image_format(const std::string& name, image_format& format);
+
+    struct image_options{
+        image_format format;
+        int scale;               // Pixels per grid position along each side
+        int top, left;           // First grid row and column of the region drawn
+        int rows, cols;          // Region size in grid positions, 0 to reach the edge of the maze
+        int threads;             // Bands rendered at once, 0 for one per hardware thread
+        int band_rows;           // Grid rows per band; each band holds only its own pixels
+
+        image_options() : format(image_format::png), scale(1), top(0), left(0), rows(0), cols(0), threads(0),
+                          band_rows(64) {};
+    };
+
+    class image_encoder;
+
+    /*
+     Draws a region of a maze view as an image. Bands of band_rows grid rows are
+     rendered on up to threads threads, each into a buffer of its own, and
+     written out in order, so memory stays at threads bands whatever the maze
+     size. path is an overlay of the same size as maze whose open passages are
+     drawn as the path (see trace_path), or null. View as for find_path.
+     return False if the region is empty or out could not be written.
+     */
+    template <typename View>
+    bool write_image(std::ostream& out, const View& maze, const compact_walls* path, const image_options& opts);
+
+    /*
+     Encodes rows as they arrive, for streaming generation. The region, scale
+     and format of the options apply, and band_rows rows are buffered at a time;
+     threads does not.
+     */
+    class image_sink : public row_sink{
+        private:
+            std::ostream& out_;
+            image_options opts_;
+            std::unique_ptr<image_encoder> encoder_;
+            std::vector<unsigned char> line_;
+            int x_;
+        public:
+            image_sink(std::ostream& out, const image_options& opts);
+            ~image_sink();
+            void begin(int height, int width) override;
+            void row(const char* row, int width) override;
+            void end() override;
+            bool ok()const override;
+    };
+}
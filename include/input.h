@@ -0,0 +1,36 @@
+#pragma once
+#include <string>
+#include <cstddef>
+
+namespace maze_gen{
+    enum class play_key{
+        none, up, down, left, right, quit
+    };
+
+    /*
+     Turns raw terminal input into keys: WASD in either case, the arrow keys
+     (ESC [ A-D and ESC O A-D) and Q. Bytes may arrive split across reads;
+     an incomplete escape sequence waits for more input or for flush().
+     */
+    class key_decoder{
+        private:
+            std::string pending_;
+        public:
+            void feed(const char* data, size_t size){ pending_.append(data, size); }
+            bool next(play_key& key);
+            // True while the input ends in the middle of an escape sequence.
+            bool waiting()const{ return !pending_.empty(); }
+            // Drops an escape sequence that never completed, such as a lone ESC.
+            void flush(){ pending_.clear(); }
+    };
+
+    struct play_stats{
+        bool escaped;  // Reached the exit
+        size_t moves;  // Steps taken
+        size_t keys;   // Keys decoded, including blocked moves
+        size_t frames; // Frames drawn
+        unsigned x, y; // Final position
+
+        play_stats() : escaped(false), moves(0), keys(0), frames(0), x(1), y(1) {};
+    };
+}
@@ -0,0 +1,122 @@
+#pragma once
+#include <compact.h>
+#include <solver.h>
+#include <array>
+#include <vector>
+#include <string>
+#include <ostream>
+#include <cstdint>
+#include <cstddef>
+
+/*
+ Lattice maze file format, version 1. All integers are little-endian.
+
+   offset  size  field
+   0       4     magic "MAZN"
+   4       2     version (1)
+   6       2     dimensions N
+   8       4N    cells along each axis, axis 0 first
+   ...     b     passage bits, N per cell in cell order (bit a of a cell is its
+                 passage along axis a), packed from the least significant bit of
+                 each byte; b = ceil(cells * N / 8)
+   ...     4     CRC-32 of the passage bytes
+ */
+
+namespace maze_gen{
+    constexpr char LATTICE_MAGIC[4] = {'M', 'A', 'Z', 'N'};
+    constexpr uint16_t LATTICE_VERSION = 1;
+
+    // Cells of a lattice maze from its first to its last cell; see lattice::solve.
+    struct lattice_path{
+        bool found;
+        std::vector<size_t> cells;
+        solve_stats stats;
+
+        lattice_path() : found(false) {};
+    };
+
+    /*
+     Perfect maze over a dense N-dimensional grid of cells. Axis 0 varies
+     slowest; for layered mazes (N = 3) it is the floor, then the row and the
+     column, and a passage along axis 0 is a stair. Each cell holds one bit per
+     axis for the passage to the next cell along it, as compact_walls does with
+     its south and east bits for N = 2.
+
+     N is a template parameter so coordinate loops unroll and every neighbor is
+     a fixed stride away. The entrance is the first cell and the exit the last.
+     The 2D maze_generator keeps its own specialized storage and algorithms;
+     to_compact() converts a 2D lattice for it.
+     */
+    template <int N>
+    class lattice{
+        static_assert(N >= 1 && N <= 8, "passage bits of a cell must fit in a byte");
+        public:
+            typedef std::array<int, N> point;
+        private:
+            point dims_;
+            std::array<size_t, N> stride_;
+            std::vector<uint8_t> links_;
+        public:
+            lattice() : dims_(), stride_() {};
+
+            // Resizes to dims cells along the axes with every passage closed; false if a size is below 1.
+            bool assign(const point& dims);
+            void clear(){ dims_ = point(); links_ = std::vector<uint8_t>(); }
+
+            size_t id(const point& p)const{
+                size_t i = 0;
+                for (int a = 0; a < N; ++a)
+                    i += size_t(p[a]) * stride_[a];
+                return i;
+            }
+            point coords(size_t id)const{
+                point p;
+                for (int a = 0; a < N; ++a) {
+                    p[a] = int(id / stride_[a]);
+                    id %= stride_[a];
+                }
+                return p;
+            }
+
+            // Passage of cell i to the next cell along axis, or to the previous one when forward is false.
+            bool passage(size_t i, const point& p, int axis, bool forward)const{
+                if (forward)
+                    return links_[i] >> axis & 1;
+                return p[axis] > 0 && (links_[i - stride_[axis]] >> axis & 1);
+            }
+            void carve(size_t i, int axis){ links_[i] |= uint8_t(1u << axis); }
+            unsigned links(size_t i)const{ return links_[i]; }
+
+            const point& dims()const{ return dims_; }
+            size_t stride(int axis)const{ return stride_[axis]; }
+            size_t cells()const{ return links_.size(); }
+            size_t bytes()const{ return links_.size(); }
+            bool empty()const{ return links_.empty(); }
+
+            /*
+             Carves a perfect maze over all cells with randomized depth-first
+             backtracking. The same seed and dimensions build the same maze.
+             */
+            void generate(uint64_t seed);
+            // Breadth-first search from the first cell to the last.
+            lattice_path solve()const;
+
+            bool save(const std::string& filename, std::string& error)const;
+            bool load(const std::string& filename, std::string& error);
+    };
+
+    // Cells of a layered maze with a stair to the next floor, the previous one or both
+    constexpr char STAIR_UP = '<';
+    constexpr char STAIR_DOWN = '>';
+    constexpr char STAIR_BOTH = 'X';
+
+    /*
+     Writes a layered maze floor by floor in the text form of print_maze, each
+     floor headed by its number. Cells with a stair show it; other cells and
+     passages on path show PATH.
+     */
+    void write_text(std::ostream& out, const lattice<3>& maze, const lattice_path* path = nullptr);
+
+    // The same maze as compact_walls, with axis 0 as rows and axis 1 as columns.
+    compact_walls to_compact(const lattice<2>& maze);
+}
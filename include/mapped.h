@@ -0,0 +1,91 @@
+#pragma once
+#include <grid.h>
+#include <format.h>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+namespace maze_gen{
+    /*
+     Read-only view of a version 2 maze file mapped into memory. Opening reads
+     only the header; rows are paged in by the operating system when touched, so
+     a region of a very large maze can be shown or solved without loading it.
+     Files saved with FLAG_STORED have every row at a computable offset. For
+     compressed files open() walks the block heads once, and a run-length
+     block is decoded the first time one of its rows is read; decoded blocks
+     are kept until close(), so only the blocks a region touches cost memory.
+     */
+    class mapped_maze{
+        private:
+            const unsigned char* base_;
+            size_t size_;
+#ifdef _WIN32
+            void* file_;
+            void* mapping_;
+#else
+            int fd_;
+#endif
+            maze_header header_;
+            bool raw_;
+            size_t row_bytes_;    // Bytes of one stored row
+            size_t block_stride_; // Bytes from one block to the next, head and padding included
+            std::vector<uint64_t> blocks_; // File offset of each block head; empty for FLAG_STORED files
+            mutable std::vector<std::vector<unsigned char>> decoded_; // Run-length blocks decoded so far
+            mutable std::unique_ptr<std::atomic<const unsigned char*>[]> ready_; // Decoded block data, once set
+            mutable std::mutex decode_mutex_;
+
+            size_t block_bytes(size_t block)const;
+            const unsigned char* block_data(size_t block)const;
+            const unsigned char* row_data(int row)const;
+        public:
+            mapped_maze();
+            ~mapped_maze();
+            mapped_maze(const mapped_maze&) = delete;
+            mapped_maze& operator=(const mapped_maze&) = delete;
+
+            bool open(const std::string& filename, std::string& error);
+            void close();
+            bool is_open()const{ return base_ != nullptr; }
+
+            // Verifies every block checksum; touches the whole file.
+            bool verify(std::string& error)const;
+
+            // Passage bits of logical cell (r, c), as compact_walls::get.
+            unsigned get(int r, int c)const;
+            bool is_wall(int x, int y)const;
+            int height()const{ return int(header_.height); }
+            int width()const{ return int(header_.width); }
+            const std::string& name()const{ return header_.name; }
+    };
+
+    /*
+     Window of a maze view: grid positions [x0, x0 + height) x [y0, y0 + width).
+     x0 and y0 must be even so cells stay at odd coordinates; solving over a window
+     only explores cells inside it.
+     */
+    template <typename View>
+    class region_view{
+        private:
+            const View* maze_;
+            int x0_, y0_, height_, width_;
+        public:
+            region_view(const View& maze, int x0, int y0, int height, int width)
+                : maze_(&maze), x0_(x0), y0_(y0), height_(height), width_(width) {};
+            bool is_wall(int x, int y)const{ return maze_->is_wall(x0_ + x, y0_ + y); }
+            int height()const{ return height_; }
+            int width()const{ return width_; }
+            int top()const{ return x0_; }
+            int left()const{ return y0_; }
+    };
+
+    /*
+     Writes a region in the print_maze style, marking the cells of path (region
+     coordinates) and the passages between consecutive cells.
+     */
+    template <typename View>
+    void print_region(std::ostream& out, const region_view<View>& region, const std::vector<cell>* path = nullptr);
+}
@@ -1,5 +1,25 @@
 #pragma once
 #include <driver.h>
+#include <grid.h>
+#include <compact.h>
+#include <solver.h>
+#include <frontier.h>
+#include <carve.h>
+#include <algorithms.h>
+#include <stream.h>
+#include <batch.h>
+#include <format.h>
+#include <mapped.h>
+#include <render.h>
+#include <input.h>
+#include <profile.h>
+#include <distance.h>
+#include <simd.h>
+#include <analysis.h>
+#include <server.h>
+#include <field.h>
+#include <lattice.h>
+#include <image.h>
 #include <vector>
 #include <iostream>
 #include <string>
@@ -7,9 +27,10 @@
 #include <fstream>
 #include <algorithm>
 #include <sstream>
-#include <stack>
 #include <termios.h>
 #include <unistd.h>
+#include <thread>
+#include <cstdint>
 #define RED "\033[31m"
 #define RESET "\033[0m"
 #define WALL '#'
@@ -20,44 +41,98 @@
 namespace maze_gen{
     struct maze{
         int width, height;
-        std::vector<std::vector<char>> grid;
-        std::vector<std::vector<bool>> visited;
+        grid2d<char> grid;             // Row-major, height rows of width positions
+        grid2d<unsigned char> visited; // Byte plane, avoids the vector<bool> bit proxies
+        compact_walls packed;          // Used instead of grid/visited in compact storage mode
         std::string name;
 
         maze() : width(0), height(0), name("Unnamed") {};
-        maze(int w, int h) : width(w), height(h), name("Unnamed") {};
+        maze(int w, int h) : width(w), height(h), grid(h, w, WALL), visited(h, w, false), name("Unnamed") {};
     };
 
-    struct cell{
-        unsigned int x, y;
-    
-        cell() : x(0), y(0) {};
-        cell(unsigned int x, unsigned int y): x(x), y(y) {}
+    // Up to four neighboring cells, held inline so enumerating them never allocates.
+    struct neighbor_list{
+        cell cells[4];
+        int count;
+
+        neighbor_list() : count(0) {};
+        size_t size()const{ return size_t(count); }
+        bool empty()const{ return count == 0; }
+        const cell& operator[](size_t i)const{ return cells[i]; }
+        const cell* begin()const{ return cells; }
+        const cell* end()const{ return cells + count; }
     };
 
     class maze_generator{
         private:
             maze current_maze;
             int width, height;
-            std::mt19937 rng; // pseudo random number generator
+            maze_rng rng;     // Pseudo random number generator, reseeded from seed for every maze
+            storage_mode storage;
+            maze_algorithm algorithm;
+            solver_algorithm solver; // Used by solve() without arguments
+            bool compress_files;     // Run-length encode blocks in save()
+            bool verbose;            // Print status messages
+            uint64_t seed;           // Seed of the current maze
+            bool fixed_seed;         // Reuse seed instead of drawing a new one per maze
+            int threads;             // Workers for tiled generation and the parallel solver
+            int tile_cells;          // Tile side in logical cells, 0 for a single tree
+            std::vector<cell> carve_stack; // Backtracking stack of carve_maze, reused between mazes
+            distance_index index;    // Path index of the current maze, empty until build_index()
+            distance_field field;    // Distances from the entrance, empty until track_distances()
 
             void carve_maze(int x, int y);
+            bool edit_wall(const cell& c, int dir, bool wall);
+            void print_rows(std::ostream& out, const compact_walls* path)const;
+            bool has_maze()const;
+            uint32_t fingerprint()const;
+            bool load_original_format(std::istream& file, maze& loaded);
             void add_entrance_and_exit();
-            std::vector<cell> get_unvisited_cells()const;
+            size_t count_unvisited()const;
+            cell next_unvisited_cell(size_t& cursor)const;
         public:
             maze_generator();
             maze_generator(int w, int h);
             
             void get_width_and_height();
+            void set_size(int w, int h);
+            void set_storage(storage_mode mode);
+            storage_mode get_storage()const;
+            void set_algorithm(maze_algorithm algo);
+            maze_algorithm get_algorithm()const;
+            void set_solver(solver_algorithm algo);
+            solver_algorithm get_solver()const;
+            void set_seed(uint64_t s);
+            void clear_seed();
+            uint64_t get_seed()const;
+            void set_threads(int n);
+            void set_tile_size(int cells);
             void generate_maze();
+            void stream_maze(row_sink& sink);
             void print_maze()const;
-            void save(const std::string& filename);
+            bool save(const std::string& filename);
             bool load(const std::string& filename);
+            void set_compression(bool enabled);
+            void set_verbose(bool enabled);
+            void write_rows(row_sink& sink)const;
+            bool save_image(const std::string& filename, const image_options& opts, bool with_path)const;
+            const maze& get_maze()const{ return current_maze; }
+            bool inspect(const std::string& filename, int top, int left, int rows, int cols)const;
             void solve();
+            void solve(solver_algorithm algo, const cell& start, const cell& goal);
+            solve_result find_path(solver_algorithm algo, const cell& start, const cell& goal)const;
+            bool build_index();
+            maze_analysis analyze()const;
+            const distance_index& get_index()const{ return index; }
+            void track_distances();
+            const distance_field& get_distances()const{ return field; }
+            bool open_wall(const cell& c, int dir);
+            bool close_wall(const cell& c, int dir);
             void play()const;
+            play_stats play(int in_fd, int out_fd)const;
             bool if_unvisited()const;
-            std::vector<cell> get_neighbors(cell& c)const;
-            std::vector<cell> get_neighbors_solver(cell& c)const;
+            neighbor_list get_neighbors(const cell& c)const;
+            neighbor_list get_neighbors_solver(const cell& c)const;
             void remove_wall(cell &first, cell &second);
     };
 
@@ -0,0 +1,65 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+namespace maze_gen{
+    /*
+     Hot-path instrumentation: time spent per phase and event counters, summed over
+     every generator and thread of the process. Only builds configured with
+     -DMAZE_PROFILE=ON record anything; otherwise MAZE_PROFILE_SCOPE and
+     MAZE_PROFILE_COUNT expand to nothing and the report says it is disabled.
+     Phase times are inclusive: unvisited_scan also counts towards carve.
+     */
+    namespace profile{
+        enum class phase{
+            grid_init, carve, unvisited_scan, solve, save, load, print, count
+        };
+
+        enum class counter{
+            cells_visited, backtracks, random_jumps, nodes_expanded, bytes_written, bytes_read, count
+        };
+
+#ifdef MAZE_PROFILE
+        constexpr bool enabled = true;
+#else
+        constexpr bool enabled = false;
+#endif
+
+        const char* phase_name(phase p);
+        const char* counter_name(counter c);
+        void add_time(phase p, uint64_t ns);
+        void add(counter c, uint64_t n);
+        void reset();
+        void write_text(std::ostream& out);
+        void write_json(std::ostream& out);
+
+        // Adds the lifetime of the object to a phase.
+        class scoped_timer{
+            private:
+                phase phase_;
+                std::chrono::steady_clock::time_point start_;
+            public:
+                explicit scoped_timer(phase p) : phase_(p), start_(std::chrono::steady_clock::now()) {};
+                ~scoped_timer(){
+                    add_time(phase_, uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - start_).count()));
+                }
+                scoped_timer(const scoped_timer&) = delete;
+                scoped_timer& operator=(const scoped_timer&) = delete;
+        };
+    }
+}
+
+#ifdef MAZE_PROFILE
+#define MAZE_PROFILE_JOIN2(a, b) a##b
+#define MAZE_PROFILE_JOIN(a, b) MAZE_PROFILE_JOIN2(a, b)
+// Times the rest of the enclosing block as the named phase.
+#define MAZE_PROFILE_SCOPE(name) \
+    ::maze_gen::profile::scoped_timer MAZE_PROFILE_JOIN(profile_scope_, __LINE__)(::maze_gen::profile::phase::name)
+// Adds n to the named counter; n is not evaluated when profiling is off.
+#define MAZE_PROFILE_COUNT(name, n) ::maze_gen::profile::add(::maze_gen::profile::counter::name, uint64_t(n))
+#else
+#define MAZE_PROFILE_SCOPE(name) ((void)0)
+#define MAZE_PROFILE_COUNT(name, n) ((void)0)
+#endif
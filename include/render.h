@@ -0,0 +1,58 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstddef>
+
+namespace maze_gen{
+    /*
+     Draws a maze on an ANSI terminal. The renderer remembers what is on screen
+     and each frame sends only cursor moves and the positions whose glyph changed,
+     assembled in one reused buffer and written with a single write(). Mazes
+     larger than the terminal are shown through a viewport that scrolls to keep
+     the focus position in view.
+     */
+    class terminal_renderer{
+        private:
+            int fd_;
+            int screen_rows_, screen_cols_;
+            int view_rows_, view_cols_;  // Maze positions shown; each takes two terminal columns
+            int top_, left_;             // Maze position at the top-left of the viewport
+            int focus_x_, focus_y_;
+            std::vector<char> back_;     // Glyphs of the frame being drawn
+            std::vector<char> front_;    // Glyphs on screen, 0 where unknown
+            std::string status_, shown_status_;
+            std::string out_;            // Escape sequences of one frame
+            bool clear_;
+            size_t bytes_written_;
+
+            void layout(int height, int width);
+            void present();
+            void flush();
+        public:
+            explicit terminal_renderer(int fd);
+
+            void begin();        // Switches to the alternate screen and hides the cursor
+            void end();          // Restores the screen and cursor
+            void query_size();   // Reads the terminal size; keeps the current one if fd is not a terminal
+            void resize(int rows, int cols);
+            void focus(int x, int y);
+            void invalidate();   // Forgets the screen contents; the next frame is drawn in full
+            size_t bytes_written()const{ return bytes_written_; }
+
+            /*
+             Draws one frame. glyph(x, y) returns WALL, CELL or PATH for a grid position;
+             PATH is shown highlighted. status is shown on the line under the maze.
+             */
+            template <typename Glyph>
+            void draw(int height, int width, Glyph glyph, const std::string& status){
+                layout(height, width);
+                for (int i = 0; i < view_rows_; ++i) {
+                    char* row = &back_[size_t(i) * view_cols_];
+                    for (int j = 0; j < view_cols_; ++j)
+                        row[j] = glyph(top_ + i, left_ + j);
+                }
+                status_ = status;
+                present();
+            }
+    };
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <iterator>
+#include <utility>
+
+namespace maze_gen{
+    /*
+     xoshiro256** with 32 bytes of state, seeded through splitmix64. Usable as a
+     standard UniformRandomBitGenerator, but generation code draws through
+     bounded(), coin() and shuffle(): the <random> distributions and std::shuffle
+     are implementation-defined, so only these keep a seed producing the same
+     maze with every compiler and standard library.
+     */
+    class maze_rng{
+        private:
+            uint64_t s_[4];
+
+            static uint64_t rotl(uint64_t x, int k){ return (x << k) | (x >> (64 - k)); }
+        public:
+            typedef uint64_t result_type;
+
+            explicit maze_rng(uint64_t seed = 0){ this->seed(seed); }
+
+            void seed(uint64_t seed){
+                for (uint64_t &s : s_) {
+                    uint64_t z = (seed += 0x9E3779B97F4A7C15ull);
+                    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+                    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+                    s = z ^ (z >> 31);
+                }
+            }
+
+            static constexpr result_type min(){ return 0; }
+            static constexpr result_type max(){ return ~uint64_t(0); }
+
+            result_type operator()(){
+                const uint64_t result = rotl(s_[1] * 5, 7) * 9;
+                const uint64_t t = s_[1] << 17;
+                s_[2] ^= s_[0];
+                s_[3] ^= s_[1];
+                s_[1] ^= s_[2];
+                s_[0] ^= s_[3];
+                s_[2] ^= t;
+                s_[3] = rotl(s_[3], 45);
+                return result;
+            }
+
+            // Uniform value in [0, n), n > 0. Multiply-shift with rejection (Lemire), no division in the common case.
+            uint64_t bounded(uint64_t n){
+                if (n > 0xFFFFFFFFull) {
+                    const uint64_t limit = max() - max() % n;
+                    uint64_t x;
+                    do x = (*this)(); while (x >= limit);
+                    return x % n;
+                }
+                const uint32_t n32 = uint32_t(n);
+                uint64_t m = ((*this)() >> 32) * n32;
+                if (uint32_t(m) < n32) {
+                    const uint32_t threshold = uint32_t(-n32) % n32;
+                    while (uint32_t(m) < threshold)
+                        m = ((*this)() >> 32) * n32;
+                }
+                return m >> 32;
+            }
+
+            bool coin(){ return (*this)() >> 63; }
+
+            // Fisher-Yates shuffle drawing through bounded().
+            template <typename It>
+            void shuffle(It first, It last){
+                for (auto n = std::distance(first, last); n > 1; --n)
+                    std::swap(first[n - 1], first[bounded(uint64_t(n))]);
+            }
+    };
+}
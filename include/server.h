@@ -0,0 +1,153 @@
+#pragma once
+#include <algorithms.h>
+#include <compact.h>
+#include <ostream>
+#include <string>
+#include <list>
+#include <deque>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+namespace maze_gen{
+    class maze_generator;
+
+    // Identifies a maze: the seed, size and algorithm fully determine it.
+    struct maze_key{
+        uint64_t seed;
+        int width, height;
+        maze_algorithm algo;
+
+        bool operator==(const maze_key& o)const{
+            return seed == o.seed && width == o.width && height == o.height && algo == o.algo;
+        }
+    };
+
+    struct maze_key_hash{
+        size_t operator()(const maze_key& k)const;
+    };
+
+    /*
+     A generated maze held by the cache, with its solution from entrance to exit
+     once a client has asked for it. The walls never change after insertion; the
+     solution is filled in once, under solve_lock.
+     */
+    struct cached_maze{
+        compact_walls walls;
+        std::mutex solve_lock;
+        bool solved;
+        compact_walls path;       // Path overlay (see trace_path), empty until solved
+        size_t path_cells;
+
+        cached_maze() : solved(false), path_cells(0) {};
+        size_t bytes()const{ return sizeof(*this) + walls.bytes() + path.bytes(); }
+    };
+
+    struct cache_stats{
+        size_t hits, misses, evictions;
+        size_t entries, bytes, budget;
+
+        cache_stats() : hits(0), misses(0), evictions(0), entries(0), bytes(0), budget(0) {};
+    };
+
+    /*
+     Least recently used cache of mazes with a memory budget. Entries are shared, so
+     one evicted while a client is still reading it stays alive until that client is
+     done. Safe to use from several threads.
+     */
+    class maze_cache{
+        private:
+            typedef std::list<std::pair<maze_key, std::shared_ptr<cached_maze>>> lru_list;
+            struct slot{
+                lru_list::iterator at;
+                size_t bytes;        // Charged against the budget
+            };
+
+            size_t budget_;
+            mutable std::mutex lock_;
+            lru_list order_;         // Most recently used first
+            std::unordered_map<maze_key, slot, maze_key_hash> slots_;
+            cache_stats stats_;
+
+            void evict();
+        public:
+            explicit maze_cache(size_t budget_bytes);
+
+            // Returns the entry and marks it most recently used, or null; counts a hit or a miss.
+            std::shared_ptr<cached_maze> find(const maze_key& key);
+            /*
+             Adds an entry, evicting the least recently used ones to stay within the budget.
+             Returns the entry now cached for key, which is an earlier one if another
+             thread inserted the same maze first. Entries larger than the whole budget
+             are returned without being kept.
+             */
+            std::shared_ptr<cached_maze> insert(const maze_key& key, std::shared_ptr<cached_maze> entry);
+            // Charges the cache again for an entry that has grown, such as by its solution.
+            void update(const maze_key& key, const cached_maze& entry);
+            cache_stats stats()const;
+    };
+
+    struct server_options{
+        int workers;             // Connections served at once; values below 1 use one per hardware thread
+        size_t cache_bytes;      // Memory budget of the maze cache
+        storage_mode storage;    // Memory layout of the generators and cached mazes; the mazes are the same either way
+        size_t max_positions;    // Largest width * height a client may ask for
+        int idle_ms;             // Connections idle for longer are closed
+
+        server_options() : workers(0), cache_bytes(size_t(256) << 20), storage(storage_mode::bytes),
+                           max_positions(size_t(1) << 26), idle_ms(60000) {};
+    };
+
+    /*
+     Serves mazes over a Unix domain socket. Each connection sends requests of one
+     line and gets one response per request:
+
+       GENERATE width height algo seed
+       SOLVE width height algo seed
+       REGION width height algo seed top left rows cols
+       STATS
+       QUIT
+
+     GENERATE, SOLVE and REGION answer "OK rows cols hit|miss" followed by that many
+     lines of grid positions as WALL, CELL and, for SOLVE, PATH characters. REGION
+     clips the area like maze_generator::inspect. STATS answers "OK" and a JSON
+     object of the cache counters on the same line. Errors answer "ERR message".
+
+     A pool of workers, each with its own maze_generator, takes connections in
+     turn. Mazes are generated once per (seed, size, algorithm) and then served
+     from the cache until evicted.
+     */
+    class maze_server{
+        private:
+            server_options options_;
+            maze_cache cache_;
+            std::string path_;
+            int listen_fd_;
+            int wake_[2];            // Self-pipe that stop() writes to
+            std::atomic<bool> stopping_;
+            std::mutex queue_lock_;
+            std::condition_variable queue_ready_;
+            std::deque<int> pending_;    // Accepted connections waiting for a worker
+
+            void serve();
+            void handle(int fd, maze_generator& generator);
+            std::shared_ptr<cached_maze> fetch(const maze_key& key, maze_generator& generator, bool& hit);
+        public:
+            explicit maze_server(const server_options& options);
+            ~maze_server();
+
+            // Binds the socket, replacing a stale socket file. Returns false with a message on failure.
+            bool listen(const std::string& path, std::string& error);
+            // Accepts and serves connections until stop(); removes the socket file on return.
+            void run();
+            // Asks run() to return once the current requests finish. Safe to call from a signal handler.
+            void stop();
+            cache_stats stats()const{ return cache_.stats(); }
+    };
+
+    void write_json(std::ostream& out, const cache_stats& stats);
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+
+namespace maze_gen{
+    /*
+     Row kernels for the byte grid. Each has a vector version, AVX2 when the
+     compiler targets it (-DMAZE_AVX2=ON) and SSE2 on any x86-64 build, and a
+     scalar version in simd::scalar that other targets use and that the
+     benchmark compares against. Both versions produce identical results.
+     */
+    namespace simd{
+        // Instruction set the vector kernels were built for: "avx2", "sse2" or "scalar".
+        const char* level();
+
+        // Writes the lattice of a cell row: WALL at even positions, CELL at odd ones.
+        void fill_lattice_row(char* row, int width);
+
+        // Counts the zero bytes at odd positions below end, the unvisited cells of a visited row.
+        size_t count_unvisited_row(const unsigned char* row, int end);
+
+        // First odd position in [from, end) holding zero, or end if there is none.
+        int next_unvisited_in_row(const unsigned char* row, int from, int end);
+
+        /*
+         Writes a grid row as text, each position followed by a space as print_maze shows it.
+         With highlight, PATH positions are wrapped in RED and RESET.
+         out needs text_row_capacity(width) bytes; returns the bytes written.
+         */
+        size_t expand_text_row(const char* row, int width, char* out, bool highlight);
+        size_t text_row_capacity(int width);
+
+        namespace scalar{
+            void fill_lattice_row(char* row, int width);
+            size_t count_unvisited_row(const unsigned char* row, int end);
+            int next_unvisited_in_row(const unsigned char* row, int from, int end);
+            size_t expand_text_row(const char* row, int width, char* out, bool highlight);
+        }
+    }
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <grid.h>
+#include <compact.h>
+#include <vector>
+#include <string>
+#include <cstddef>
+
+namespace maze_gen{
+    // Path search strategies available to maze_generator::solve
+    enum class solver_algorithm{
+        bfs,           // Breadth-first search, shortest path
+        astar,         // A* with the Manhattan distance heuristic, shortest path
+        bidirectional, // Breadth-first search from both ends, shortest path
+        dfs,           // Depth-first search, any path with the least memory
+        parallel       // Level-synchronous breadth-first search on several threads, shortest path
+    };
+
+    struct solve_stats{
+        size_t nodes_expanded; // Cells taken off the frontier
+        double elapsed_ms;
+
+        solve_stats() : nodes_expanded(0), elapsed_ms(0) {};
+    };
+
+    struct solve_result{
+        bool found;
+        std::vector<cell> path; // Grid positions of the cells from start to goal, both included
+        solve_stats stats;
+
+        solve_result() : found(false) {};
+    };
+
+    // Read-only view of a byte grid with the same interface as compact_walls.
+    class grid_view{
+        private:
+            const grid2d<char>* grid_;
+        public:
+            explicit grid_view(const grid2d<char>& grid) : grid_(&grid) {};
+            bool is_wall(int x, int y)const;
+            const char* row(int x)const{ return grid_->row(x); }
+            int height()const{ return grid_->rows(); }
+            int width()const{ return grid_->cols(); }
+    };
+
+    const char* solver_name(solver_algorithm algo);
+    bool parse_solver(const std::string& name, solver_algorithm& algo);
+
+    /*
+     Finds a path between two cell positions (odd coordinates) of a maze view.
+     View is grid_view, compact_walls, mapped_maze or region_view<mapped_maze>; all
+     answer is_wall(x, y) on grid positions. threads applies to solver_algorithm::parallel
+     only, 0 meaning one per hardware thread.
+     */
+    template <typename View>
+    solve_result find_path(const View& maze, solver_algorithm algo, const cell& start, const cell& goal, int threads = 0);
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <ostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+namespace maze_gen{
+    class maze_writer;
+
+    /*
+     Receives the grid rows of a maze in order, as WALL/CELL characters.
+     Used by streaming generation, which never holds more than one row.
+     */
+    class row_sink{
+        public:
+            virtual ~row_sink() = default;
+            virtual void begin(int height, int width) = 0;
+            virtual void row(const char* row, int width) = 0;
+            virtual void end() {}
+            virtual bool ok()const{ return true; }
+    };
+
+    // Writes rows as text, one character plus a space per position like print_maze.
+    class text_sink : public row_sink{
+        private:
+            std::ostream& out_;
+            std::string line_;
+        public:
+            explicit text_sink(std::ostream& out) : out_(out) {};
+            void begin(int height, int width) override;
+            void row(const char* row, int width) override;
+            void end() override;
+            bool ok()const override{ return bool(out_); }
+    };
+
+    // Writes rows in the maze_generator::save file format, packing each pair of grid rows as it arrives.
+    class file_sink : public row_sink{
+        private:
+            std::ofstream file_;
+            std::string name_;
+            bool compress_;
+            std::unique_ptr<maze_writer> writer_;
+            std::vector<uint64_t> words_; // Passages of the logical row being assembled
+            int height_, x_;
+        public:
+            file_sink(const std::string& filename, const std::string& name, bool compress = true);
+            ~file_sink();
+            void begin(int height, int width) override;
+            void row(const char* row, int width) override;
+            void end() override;
+            bool ok()const override{ return bool(file_); }
+    };
+}
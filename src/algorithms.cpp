@@ -0,0 +1,336 @@
+#include "maze.h"
+
+namespace maze_gen {
+
+namespace {
+
+struct node {
+    int r, c;
+};
+
+// Picks a uniform index in [0, n).
+inline int pick(maze_rng &rng, int n) {
+    return int(rng.bounded(uint64_t(n)));
+}
+
+class backtracker_strategy : public maze_strategy {
+public:
+    maze_algorithm id() const override { return maze_algorithm::backtracker; }
+    void carve(carve_target &target, const cell_region &region, maze_rng &rng) const override {
+        carve_backtracker(target, region, rng);
+    }
+};
+
+/*
+ Kruskal: visits every internal passage in random order and opens it when it joins two
+ separate trees. Holds the whole edge list plus a union-find entry per cell.
+ */
+class kruskal_strategy : public maze_strategy {
+public:
+    maze_algorithm id() const override { return maze_algorithm::kruskal; }
+    void carve(carve_target &target, const cell_region &region, maze_rng &rng) const override {
+        const int rows = region.r1 - region.r0, cols = region.c1 - region.c0;
+        // Edge = cell index * 2 + (0 for east, 1 for south)
+        std::vector<uint64_t> edges;
+        edges.reserve(size_t(rows) * cols * 2);
+        for (int r = 0; r < rows; ++r)
+            for (int c = 0; c < cols; ++c) {
+                uint64_t i = uint64_t(r) * cols + c;
+                if (c + 1 < cols)
+                    edges.push_back(i * 2);
+                if (r + 1 < rows)
+                    edges.push_back(i * 2 + 1);
+            }
+        rng.shuffle(edges.begin(), edges.end());
+
+        union_find sets(size_t(rows) * cols);
+        for (uint64_t e : edges) {
+            const int i = int(e / 2), r = i / cols, c = i % cols;
+            const bool south = e & 1;
+            if (sets.unite(i, south ? i + cols : i + 1))
+                target.carve(region.r0 + r, region.c0 + c, south ? 2 : 1);
+        }
+    }
+};
+
+/*
+ Randomized Prim: grows one tree by attaching a random frontier cell to a random
+ neighbor already in the maze.
+ */
+class prim_strategy : public maze_strategy {
+public:
+    maze_algorithm id() const override { return maze_algorithm::prim; }
+    void carve(carve_target &target, const cell_region &region, maze_rng &rng) const override {
+        const int rows = region.r1 - region.r0, cols = region.c1 - region.c0;
+        bit_plane in_maze, queued;
+        in_maze.assign(rows, cols, 1);
+        queued.assign(rows, cols, 1);
+        std::vector<node> frontier;
+
+        auto add = [&](int r, int c) {
+            in_maze.set_bits(r, c, 1);
+            for (int d = 0; d < 4; ++d) {
+                int nr = r + dir_row[d], nc = c + dir_col[d];
+                if (nr >= 0 && nr < rows && nc >= 0 && nc < cols && !in_maze.get(nr, nc) && !queued.get(nr, nc)) {
+                    queued.set_bits(nr, nc, 1);
+                    frontier.push_back({nr, nc});
+                }
+            }
+        };
+        add(0, 0);
+
+        while (!frontier.empty()) {
+            int i = pick(rng, int(frontier.size()));
+            node n = frontier[i];
+            frontier[i] = frontier.back();
+            frontier.pop_back();
+
+            unsigned mask = 0;
+            for (int d = 0; d < 4; ++d) {
+                int nr = n.r + dir_row[d], nc = n.c + dir_col[d];
+                mask |= unsigned(nr >= 0 && nr < rows && nc >= 0 && nc < cols && in_maze.get(nr, nc)) << d;
+            }
+            const direction_set &options = direction_sets[mask];
+            target.carve(region.r0 + n.r, region.c0 + n.c, options.dir[pick(rng, options.count)]);
+            add(n.r, n.c);
+        }
+    }
+};
+
+// Eller: the rows produced by eller_rows, written straight into the target.
+class eller_strategy : public maze_strategy {
+public:
+    maze_algorithm id() const override { return maze_algorithm::eller; }
+    void carve(carve_target &target, const cell_region &region, maze_rng &rng) const override {
+        const int rows = region.r1 - region.r0, cols = region.c1 - region.c0;
+        eller_rows source(cols);
+        std::vector<unsigned char> links(cols);
+        for (int r = 0; r < rows; ++r) {
+            source.next(rng, r + 1 == rows, links.data());
+            for (int c = 0; c < cols; ++c) {
+                if (links[c] & compact_walls::east)
+                    target.carve(region.r0 + r, region.c0 + c, 1);
+                if (links[c] & compact_walls::south)
+                    target.carve(region.r0 + r, region.c0 + c, 2);
+            }
+        }
+    }
+};
+
+/*
+ Wilson: loop-erased random walks from each cell outside the tree until they hit it.
+ Produces a uniformly random spanning tree. The walk keeps a 2-bit exit direction per
+ cell, so revisiting a cell overwrites (erases) the loop.
+ */
+class wilson_strategy : public maze_strategy {
+public:
+    maze_algorithm id() const override { return maze_algorithm::wilson; }
+    void carve(carve_target &target, const cell_region &region, maze_rng &rng) const override {
+        const int rows = region.r1 - region.r0, cols = region.c1 - region.c0;
+        bit_plane in_tree, exit_dir;
+        in_tree.assign(rows, cols, 1);
+        exit_dir.assign(rows, cols, 2);
+
+        const int root = pick(rng, rows * cols);
+        in_tree.set_bits(root / cols, root % cols, 1);
+
+        for (int sr = 0; sr < rows; ++sr)
+            for (int sc = 0; sc < cols; ++sc) {
+                // Random walk until the tree is reached, remembering the last exit from each cell
+                int r = sr, c = sc;
+                while (!in_tree.get(r, c)) {
+                    const unsigned mask = unsigned(r > 0) | unsigned(c + 1 < cols) << 1 | unsigned(r + 1 < rows) << 2 |
+                                          unsigned(c > 0) << 3;
+                    const direction_set &options = direction_sets[mask];
+                    int d = options.dir[pick(rng, options.count)];
+                    exit_dir.set(r, c, d);
+                    r += dir_row[d];
+                    c += dir_col[d];
+                }
+                // Retrace the loop-erased walk, adding it to the tree
+                r = sr;
+                c = sc;
+                while (!in_tree.get(r, c)) {
+                    int d = exit_dir.get(r, c);
+                    in_tree.set_bits(r, c, 1);
+                    target.carve(region.r0 + r, region.c0 + c, d);
+                    r += dir_row[d];
+                    c += dir_col[d];
+                }
+            }
+    }
+};
+
+// Binary tree: every cell opens north or west, chosen by a coin flip where both exist.
+class binary_tree_strategy : public maze_strategy {
+public:
+    maze_algorithm id() const override { return maze_algorithm::binary_tree; }
+    void carve(carve_target &target, const cell_region &region, maze_rng &rng) const override {
+        for (int r = region.r0; r < region.r1; ++r)
+            for (int c = region.c0; c < region.c1; ++c) {
+                const bool north = r > region.r0, west = c > region.c0;
+                if (north && west)
+                    target.carve(r, c, rng.coin() ? 0 : 3);
+                else if (north)
+                    target.carve(r, c, 0);
+                else if (west)
+                    target.carve(r, c, 3);
+            }
+    }
+};
+
+/*
+ Sidewinder: the first row is one corridor; every later row is cut into runs of
+ east passages and each run opens north from one random cell.
+ */
+class sidewinder_strategy : public maze_strategy {
+public:
+    maze_algorithm id() const override { return maze_algorithm::sidewinder; }
+    void carve(carve_target &target, const cell_region &region, maze_rng &rng) const override {
+        for (int c = region.c0; c + 1 < region.c1; ++c)
+            target.carve(region.r0, c, 1);
+        for (int r = region.r0 + 1; r < region.r1; ++r) {
+            int run_start = region.c0;
+            for (int c = region.c0; c < region.c1; ++c) {
+                if (c + 1 < region.c1 && rng.coin()) {
+                    target.carve(r, c, 1);
+                } else {
+                    target.carve(r, run_start + pick(rng, c - run_start + 1), 0);
+                    run_start = c + 1;
+                }
+            }
+        }
+    }
+};
+
+}
+
+eller_rows::eller_rows(int cols)
+    : cols_(cols), sets_(cols), parent_(cols), remap_(cols), order_(cols), start_(cols + 1) {
+    std::iota(sets_.begin(), sets_.end(), 0); // Every cell of the first row is its own set
+}
+
+int eller_rows::find(int a) {
+    while (parent_[a] != a)
+        a = parent_[a] = parent_[parent_[a]];
+    return a;
+}
+
+/*
+Produces the passages of the next row and advances the set labels.
+param rng Random number generator.
+param last True for the final row, which joins all sets.
+param links Output, cols() entries of compact_walls::east / compact_walls::south bits.
+ */
+void eller_rows::next(maze_rng &rng, bool last, unsigned char *links) {
+    std::fill(links, links + cols_, 0);
+    std::iota(parent_.begin(), parent_.end(), 0);
+
+    // Join horizontally adjacent cells of different sets (always on the last row)
+    for (int c = 0; c + 1 < cols_; ++c) {
+        int a = find(sets_[c]), b = find(sets_[c + 1]);
+        if (a != b && (last || rng.coin())) {
+            parent_[a] = b;
+            links[c] |= compact_walls::east;
+        }
+    }
+    for (int c = 0; c < cols_; ++c)
+        sets_[c] = find(sets_[c]);
+    if (last)
+        return;
+
+    // Group the cells by set (counting sort) and open at least one cell of each set downward
+    std::fill(start_.begin(), start_.end(), 0);
+    for (int c = 0; c < cols_; ++c)
+        ++start_[sets_[c] + 1];
+    for (int i = 0; i < cols_; ++i)
+        start_[i + 1] += start_[i];
+    std::copy(start_.begin(), start_.end() - 1, remap_.begin());
+    for (int c = 0; c < cols_; ++c)
+        order_[remap_[sets_[c]]++] = c;
+
+    for (int s = 0; s < cols_; ++s) {
+        const int count = start_[s + 1] - start_[s];
+        if (count == 0)
+            continue;
+        const int forced = start_[s] + pick(rng, count);
+        for (int i = start_[s]; i < start_[s + 1]; ++i)
+            if (i == forced || rng.coin())
+                links[order_[i]] |= compact_walls::south;
+    }
+
+    // Cells that continue downward keep their set; the rest start new ones. Relabel into [0, cols)
+    std::fill(remap_.begin(), remap_.end(), -1);
+    int label = 0;
+    for (int c = 0; c < cols_; ++c) {
+        if (links[c] & compact_walls::south) {
+            int &mapped = remap_[sets_[c]];
+            if (mapped < 0)
+                mapped = label++;
+            sets_[c] = mapped;
+        } else {
+            sets_[c] = label++;
+        }
+    }
+}
+
+/*
+Returns the shared strategy object for an algorithm.
+param algo The generation algorithm.
+ */
+const maze_strategy &strategy_for(maze_algorithm algo) {
+    static const backtracker_strategy backtracker;
+    static const kruskal_strategy kruskal;
+    static const prim_strategy prim;
+    static const eller_strategy eller;
+    static const wilson_strategy wilson;
+    static const binary_tree_strategy binary_tree;
+    static const sidewinder_strategy sidewinder;
+
+    switch (algo) {
+    case maze_algorithm::kruskal: return kruskal;
+    case maze_algorithm::prim: return prim;
+    case maze_algorithm::eller: return eller;
+    case maze_algorithm::wilson: return wilson;
+    case maze_algorithm::binary_tree: return binary_tree;
+    case maze_algorithm::sidewinder: return sidewinder;
+    case maze_algorithm::backtracker: break;
+    }
+    return backtracker;
+}
+
+// Returns the command-line name of a generation algorithm.
+const char *algorithm_name(maze_algorithm algo) {
+    switch (algo) {
+    case maze_algorithm::backtracker: return "backtracker";
+    case maze_algorithm::kruskal: return "kruskal";
+    case maze_algorithm::prim: return "prim";
+    case maze_algorithm::eller: return "eller";
+    case maze_algorithm::wilson: return "wilson";
+    case maze_algorithm::binary_tree: return "binary_tree";
+    case maze_algorithm::sidewinder: return "sidewinder";
+    }
+    return "unknown";
+}
+
+std::vector<maze_algorithm> all_algorithms() {
+    return {maze_algorithm::backtracker, maze_algorithm::kruskal, maze_algorithm::prim, maze_algorithm::eller,
+            maze_algorithm::wilson, maze_algorithm::binary_tree, maze_algorithm::sidewinder};
+}
+
+/*
+Looks up a generation algorithm by its name.
+param name One of the names returned by algorithm_name.
+param algo Set to the matching algorithm.
+return True if the name is known.
+ */
+bool parse_algorithm(const std::string &name, maze_algorithm &algo) {
+    for (maze_algorithm a : all_algorithms())
+        if (name == algorithm_name(a)) {
+            algo = a;
+            return true;
+        }
+    return false;
+}
+
+}
@@ -0,0 +1,235 @@
+#include "maze.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+namespace maze_gen {
+
+namespace {
+
+const uint32_t UNSEEN = 0xFFFFFFFFu;
+
+inline int bucket_of(size_t length) {
+    int k = 0;
+    while (length >>= 1)
+        ++k;
+    return k;
+}
+
+// Runs f(first_row, end_row, band) on up to threads bands of rows, the first on the calling thread.
+template <typename F>
+void for_row_bands(int rows, int threads, F f) {
+    const int bands = std::max(1, std::min(threads, rows));
+    std::vector<std::thread> pool;
+    for (int b = 1; b < bands; ++b)
+        pool.emplace_back(f, int(int64_t(rows) * b / bands), int(int64_t(rows) * (b + 1) / bands), b);
+    f(0, int(int64_t(rows) / bands), 0);
+    for (std::thread &th : pool)
+        th.join();
+}
+
+// Totals of one row band.
+struct band_totals {
+    size_t degree[5] = {0, 0, 0, 0, 0};
+    std::vector<size_t> corridors;
+    size_t longest = 0;
+};
+
+/*
+Level-synchronous breadth-first distances over the passage masks, driven by a
+level_expander as in the parallel solver. A cell is claimed by setting its bit
+in a shared plane, so only the claiming thread writes its distance; on one
+thread the distances alone are checked. The result does not depend on the
+number of threads.
+return The cell with the lowest index among those farthest from source.
+ */
+uint32_t bfs(const std::vector<unsigned char> &open, int cols, uint32_t source, int threads,
+             std::vector<uint32_t> &dist) {
+    std::fill(dist.begin(), dist.end(), UNSEEN);
+    const int64_t step[4] = {-int64_t(cols), 1, int64_t(cols), -1};
+    threads = std::max(1, threads);
+    std::unique_ptr<std::atomic<uint64_t>[]> seen;
+    if (threads > 1) {
+        seen.reset(new std::atomic<uint64_t>[dist.size() / 64 + 1]());
+        seen[source / 64].store(uint64_t(1) << (source % 64), std::memory_order_relaxed);
+    }
+    dist[source] = 0;
+    std::vector<uint32_t> frontier(1, source);
+    level_expander<uint32_t> expander(threads);
+    uint32_t level = 0;
+
+    // Expands frontier[first, end) into out; shared is std::true_type while other threads run.
+    auto expand = [&](auto shared, size_t first, size_t end, std::vector<uint32_t> &out) {
+        for (size_t i = first; i < end; ++i) {
+            const uint32_t v = frontier[i];
+            for (int d = 0; d < 4; ++d) {
+                if (!(open[v] >> d & 1))
+                    continue;
+                const uint32_t u = uint32_t(v + step[d]);
+                const uint64_t bit = uint64_t(1) << (u % 64);
+                if (decltype(shared)::value) {
+                    std::atomic<uint64_t> &w = seen[u / 64];
+                    if ((w.load(std::memory_order_relaxed) & bit) || (w.fetch_or(bit, std::memory_order_relaxed) & bit))
+                        continue;
+                } else {
+                    // Alone, distances tell what was reached; the plane is kept for later shared levels
+                    if (dist[u] != UNSEEN)
+                        continue;
+                    if (seen) {
+                        std::atomic<uint64_t> &w = seen[u / 64];
+                        w.store(w.load(std::memory_order_relaxed) | bit, std::memory_order_relaxed);
+                    }
+                }
+                dist[u] = level + 1;
+                out.push_back(u);
+            }
+        }
+    };
+
+    // The last level reached stays in frontier
+    while (expander.step(frontier, expand))
+        ++level;
+    return *std::min_element(frontier.begin(), frontier.end());
+}
+
+}
+
+template <typename View>
+maze_analysis analyze_maze(const View &maze, int threads) {
+    const auto started = std::chrono::steady_clock::now();
+    maze_analysis a;
+    const int rows = (maze.height() - 1) / 2, cols = (maze.width() - 1) / 2;
+    if (rows < 1 || cols < 1)
+        return a;
+    const size_t n = size_t(rows) * cols;
+    a.cells = n;
+    const int64_t step[4] = {-int64_t(cols), 1, int64_t(cols), -1};
+
+    // Pass 1: passage masks; every cell reads its own four walls, so bands never share a write
+    std::vector<unsigned char> open(n);
+    std::vector<band_totals> totals(size_t(std::max(1, std::min(threads, rows))));
+    for_row_bands(rows, threads, [&](int r0, int r1, int band) {
+        band_totals &t = totals[band];
+        for (int r = r0; r < r1; ++r)
+            for (int c = 0; c < cols; ++c) {
+                const unsigned m = open_mask(maze, r, c, rows, cols);
+                open[size_t(r) * cols + c] = (unsigned char)m;
+                ++t.degree[(m & 1) + (m >> 1 & 1) + (m >> 2 & 1) + (m >> 3)];
+            }
+    });
+
+    // Pass 2: walk every corridor from its end with the lower index, so each is counted once
+    auto degree_of = [&](uint32_t v) {
+        return (open[v] & 1) + (open[v] >> 1 & 1) + (open[v] >> 2 & 1) + (open[v] >> 3);
+    };
+    for_row_bands(rows, threads, [&](int r0, int r1, int band) {
+        band_totals &t = totals[band];
+        for (uint32_t v = uint32_t(r0) * cols; v < uint32_t(r1) * cols; ++v) {
+            if (degree_of(v) == 2)
+                continue;
+            for (int first = 0; first < 4; ++first) {
+                if (!(open[v] >> first & 1))
+                    continue;
+                int d = first;
+                uint32_t u = uint32_t(v + step[d]);
+                size_t length = 1;
+                while (degree_of(u) == 2) {
+                    const unsigned onward = open[u] & ~(1u << (d ^ 2)); // The passage not walked in through
+                    d = onward & 1 ? 0 : onward & 2 ? 1 : onward & 4 ? 2 : 3;
+                    u = uint32_t(u + step[d]);
+                    ++length;
+                }
+                if (v < u) {
+                    const size_t k = size_t(bucket_of(length));
+                    if (t.corridors.size() <= k)
+                        t.corridors.resize(k + 1, 0);
+                    ++t.corridors[k];
+                    t.longest = std::max(t.longest, length);
+                }
+            }
+        }
+    });
+
+    for (const band_totals &t : totals) {
+        for (int k = 0; k < 5; ++k)
+            a.degree[k] += t.degree[k];
+        if (a.corridors.size() < t.corridors.size())
+            a.corridors.resize(t.corridors.size(), 0);
+        for (size_t k = 0; k < t.corridors.size(); ++k)
+            a.corridors[k] += t.corridors[k];
+        a.longest_corridor = std::max(a.longest_corridor, t.longest);
+    }
+    a.dead_ends = a.degree[1];
+    a.junctions = a.degree[3] + a.degree[4];
+    a.passages = (a.degree[1] + 2 * a.degree[2] + 3 * a.degree[3] + 4 * a.degree[4]) / 2;
+    a.branching_factor = a.junctions ? double(2 * a.degree[3] + 3 * a.degree[4]) / a.junctions : 0;
+
+    // Passes 3 and 4: from the entrance, then from the cell farthest from it
+    std::vector<uint32_t> dist(n);
+    const uint32_t exit = uint32_t(n - 1);
+    const uint32_t far = bfs(open, cols, 0, threads, dist);
+    if (dist[exit] != UNSEEN) {
+        a.solution_length = size_t(dist[exit]) + 1;
+        // Walk back along decreasing distance, counting the junctions the solver passes
+        for (uint32_t v = exit;; ) {
+            a.solution_decisions += degree_of(v) >= 3;
+            if (v == 0)
+                break;
+            for (int d = 0; d < 4; ++d) {
+                const uint32_t u = uint32_t(v + step[d]);
+                if ((open[v] >> d & 1) && dist[u] + 1 == dist[v]) {
+                    v = u;
+                    break;
+                }
+            }
+        }
+    }
+    const uint32_t other = bfs(open, cols, far, threads, dist);
+    a.diameter = size_t(dist[other]) + 1;
+    a.diameter_from = cell(2 * (far / cols) + 1, 2 * (far % cols) + 1);
+    a.diameter_to = cell(2 * (other / cols) + 1, 2 * (other % cols) + 1);
+
+    if (a.solution_length > 0) {
+        const double manhattan = double(rows - 1 + cols - 1);
+        const double tortuosity = manhattan > 0 ? (a.solution_length - 1) / manhattan : 1;
+        a.difficulty = 40 * double(a.solution_decisions) / a.solution_length +
+                       30 * std::min(1.0, 2.0 * a.dead_ends / n) + 30 * (tortuosity > 1 ? 1 - 1 / tortuosity : 0);
+    }
+    a.elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+    return a;
+}
+
+// Writes the analysis as labelled lines.
+void write_text(std::ostream &out, const maze_analysis &a) {
+    out << "Cells: " << a.cells << ", passages: " << a.passages << std::endl;
+    out << "Dead ends: " << a.dead_ends << ", junctions: " << a.junctions
+        << ", branching factor: " << a.branching_factor << std::endl;
+    out << "Corridor lengths:";
+    for (size_t k = 0; k < a.corridors.size(); ++k)
+        if (a.corridors[k])
+            out << ' ' << (size_t(1) << k) << '-' << ((size_t(2) << k) - 1) << ": " << a.corridors[k] << ';';
+    out << " longest " << a.longest_corridor << std::endl;
+    out << "Solution: " << a.solution_length << " cells, " << a.solution_decisions << " decisions" << std::endl;
+    out << "Diameter: " << a.diameter << " cells from (" << a.diameter_from.x << "," << a.diameter_from.y << ") to ("
+        << a.diameter_to.x << "," << a.diameter_to.y << ")" << std::endl;
+    out << "Difficulty: " << a.difficulty << " / 100 (analyzed in " << a.elapsed_ms << " ms)" << std::endl;
+}
+
+// Writes the analysis as one JSON object.
+void write_json(std::ostream &out, const maze_analysis &a) {
+    out << "{\"cells\":" << a.cells << ",\"passages\":" << a.passages << ",\"dead_ends\":" << a.dead_ends
+        << ",\"junctions\":" << a.junctions << ",\"branching_factor\":" << a.branching_factor << ",\"corridors\":[";
+    for (size_t k = 0; k < a.corridors.size(); ++k)
+        out << (k ? "," : "") << a.corridors[k];
+    out << "],\"longest_corridor\":" << a.longest_corridor << ",\"solution_length\":" << a.solution_length
+        << ",\"solution_decisions\":" << a.solution_decisions << ",\"diameter\":" << a.diameter
+        << ",\"difficulty\":" << a.difficulty << ",\"analyze_ms\":" << a.elapsed_ms << "}";
+}
+
+template maze_analysis analyze_maze<grid_view>(const grid_view &, int);
+template maze_analysis analyze_maze<compact_walls>(const compact_walls &, int);
+template maze_analysis analyze_maze<mapped_maze>(const mapped_maze &, int);
+
+}
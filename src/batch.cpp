@@ -0,0 +1,138 @@
+#include "maze.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace maze_gen {
+
+namespace {
+
+double elapsed_ms(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+}
+
+}
+
+/*
+Creates the worker generators; they live as long as the batch so their buffers carry over between runs.
+param workers Worker threads; values below 1 use one per hardware thread.
+param storage Storage mode of every generated maze.
+ */
+maze_batch::maze_batch(int workers, storage_mode storage)
+    : workers_(workers > 0 ? workers : int(std::max(1u, std::thread::hardware_concurrency()))), storage_(storage),
+      tile_cells_(0), compress_(true) {
+    for (int i = 0; i < workers_; ++i) {
+        generators_.emplace_back(new maze_generator());
+        generators_.back()->set_verbose(false);
+        generators_.back()->set_storage(storage_);
+        generators_.back()->set_threads(workers_ > 1 ? 1 : 0); // With several workers, parallelism comes from them
+    }
+}
+
+maze_batch::~maze_batch() = default;
+
+// Tile size passed to every worker's generator, 0 for untiled mazes.
+void maze_batch::set_tile_size(int cells) {
+    tile_cells_ = std::max(0, cells);
+    for (auto &g : generators_)
+        g->set_tile_size(tile_cells_);
+}
+
+// Threads each worker uses for tiled mazes and the parallel solver; 0 uses one per hardware thread.
+void maze_batch::set_tile_threads(int n) {
+    for (auto &g : generators_)
+        g->set_threads(n);
+}
+
+// Compression used when a consumer saves through the worker's generator.
+void maze_batch::set_compression(bool enabled) {
+    compress_ = enabled;
+    for (auto &g : generators_)
+        g->set_compression(compress_);
+}
+
+/*
+Generates, optionally solves and hands over every job, spreading jobs over the workers.
+param jobs Mazes to build.
+param results Resized to jobs.size(); entry i describes job i.
+param consumer Optional receiver of each maze, called on the worker thread.
+return Totals and throughput of the run.
+ */
+batch_stats maze_batch::run(const std::vector<batch_job> &jobs, std::vector<batch_result> &results,
+                            batch_consumer *consumer) {
+    results.assign(jobs.size(), batch_result());
+    const auto started = std::chrono::steady_clock::now();
+
+    // Jobs are claimed one at a time, so mixed sizes balance across workers
+    std::atomic<size_t> next_job(0);
+    auto worker = [&](int id) {
+        maze_generator &gen = *generators_[id];
+        for (size_t i = next_job++; i < jobs.size(); i = next_job++) {
+            const batch_job &job = jobs[i];
+            batch_result &res = results[i];
+            res.worker = id;
+
+            auto start = std::chrono::steady_clock::now();
+            gen.set_size(job.width, job.height);
+            gen.set_algorithm(job.algo);
+            gen.set_seed(job.seed);
+            gen.generate_maze();
+            res.generate_ms = elapsed_ms(start);
+
+            if (job.solve) {
+                solve_result solved = gen.find_path(job.solver, cell(1, 1), cell(job.height - 2, job.width - 2));
+                res.solved = solved.found;
+                res.path_cells = solved.path.size();
+                res.nodes_expanded = solved.stats.nodes_expanded;
+                res.solve_ms = solved.stats.elapsed_ms;
+            }
+            if (job.analyze)
+                res.analysis = gen.analyze();
+            if (job.queries > 0) {
+                start = std::chrono::steady_clock::now();
+                res.ok = gen.build_index();
+                res.index_ms = elapsed_ms(start);
+
+                // Query cells come from the job seed, so the distance sum is reproducible
+                const distance_index &index = gen.get_index();
+                const uint64_t rows = (job.height - 1) / 2, cols = (job.width - 1) / 2;
+                maze_rng pick(mix_seed(job.seed, 1));
+                start = std::chrono::steady_clock::now();
+                for (size_t q = 0; res.ok && q < job.queries; ++q) {
+                    cell a(unsigned(2 * pick.bounded(rows) + 1), unsigned(2 * pick.bounded(cols) + 1));
+                    cell b(unsigned(2 * pick.bounded(rows) + 1), unsigned(2 * pick.bounded(cols) + 1));
+                    res.distance_sum += index.distance(a, b);
+                }
+                res.query_ms = elapsed_ms(start);
+            }
+            if (consumer && res.ok) { // A maze whose index failed is not handed on
+                start = std::chrono::steady_clock::now();
+                res.ok = consumer->consume(i, job, gen);
+                res.consume_ms = elapsed_ms(start);
+            }
+        }
+    };
+
+    const int active = int(std::min<size_t>(size_t(workers_), std::max<size_t>(jobs.size(), 1)));
+    std::vector<std::thread> pool;
+    for (int id = 1; id < active; ++id)
+        pool.emplace_back(worker, id);
+    worker(0);
+    for (std::thread &th : pool)
+        th.join();
+
+    batch_stats stats;
+    stats.elapsed_ms = elapsed_ms(started);
+    stats.mazes = jobs.size();
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        stats.cells += size_t((jobs[i].width - 1) / 2) * ((jobs[i].height - 1) / 2);
+        stats.failures += !results[i].ok;
+    }
+    if (stats.elapsed_ms > 0) {
+        stats.mazes_per_sec = stats.mazes * 1000.0 / stats.elapsed_ms;
+        stats.cells_per_sec = stats.cells * 1000.0 / stats.elapsed_ms;
+    }
+    return stats;
+}
+
+}
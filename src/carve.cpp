@@ -0,0 +1,145 @@
+#include "maze.h"
+#include <atomic>
+#include <thread>
+
+namespace maze_gen {
+
+const direction_set direction_sets[16] = {
+    {0, {0, 0, 0, 0}}, {1, {0, 0, 0, 0}}, {1, {1, 0, 0, 0}}, {2, {0, 1, 0, 0}},
+    {1, {2, 0, 0, 0}}, {2, {0, 2, 0, 0}}, {2, {1, 2, 0, 0}}, {3, {0, 1, 2, 0}},
+    {1, {3, 0, 0, 0}}, {2, {0, 3, 0, 0}}, {2, {1, 3, 0, 0}}, {3, {0, 1, 3, 0}},
+    {2, {2, 3, 0, 0}}, {3, {0, 2, 3, 0}}, {3, {1, 2, 3, 0}}, {4, {0, 1, 2, 3}},
+};
+
+/*
+Derives a seed for a numbered stream so tiles and stitching draw independent sequences.
+param seed Base seed of the maze.
+param stream Stream number (tile index, or one past the last tile for stitching).
+return Mixed 64-bit seed.
+ */
+uint64_t mix_seed(uint64_t seed, uint64_t stream) {
+    uint64_t z = seed + (stream + 1) * 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+/*
+Carves a spanning tree over the cells of one region, starting at its top-left cell.
+param target Maze being carved; only passages between cells of the region are opened.
+param region Cells to carve.
+param rng Random number generator choosing the next neighbor.
+ */
+void carve_backtracker(carve_target &target, const cell_region &region, maze_rng &rng) {
+    const int rows = region.r1 - region.r0, cols = region.c1 - region.c0;
+    bit_plane visited, parent;
+    visited.assign(rows, cols, 1);
+    parent.assign(rows, cols, 2);
+
+    int r = 0, c = 0; // Current cell, relative to the region
+    visited.set_bits(r, c, 1);
+    size_t backtracks = 0;
+
+    while (true) {
+        // Bit d set when the neighbor in direction d exists and is unvisited
+        const unsigned mask = unsigned(r > 0 && !visited.get(r - 1, c)) |
+                              unsigned(c + 1 < cols && !visited.get(r, c + 1)) << 1 |
+                              unsigned(r + 1 < rows && !visited.get(r + 1, c)) << 2 |
+                              unsigned(c > 0 && !visited.get(r, c - 1)) << 3;
+        const direction_set &options = direction_sets[mask];
+        if (options.count > 0) {
+            // Carve into a random unvisited neighbor and remember the way back
+            int d = options.dir[rng.bounded(options.count)];
+            target.carve(region.r0 + r, region.c0 + c, d);
+            r += dir_row[d];
+            c += dir_col[d];
+            parent.set(r, c, d ^ 2);
+            visited.set_bits(r, c, 1);
+        } else if (r != 0 || c != 0) {
+            // Backtrack along the stored direction
+            int d = parent.get(r, c);
+            r += dir_row[d];
+            c += dir_col[d];
+            ++backtracks;
+        } else {
+            break; // Back at the start: the region is connected, so every cell is carved
+        }
+    }
+    MAZE_PROFILE_COUNT(cells_visited, size_t(rows) * cols);
+    MAZE_PROFILE_COUNT(backtracks, backtracks);
+    (void)backtracks;
+}
+
+namespace {
+
+// Adjacency between tile a and the tile east of it (dir 1) or south of it (dir 2).
+struct tile_join {
+    int a, b, dir;
+};
+
+}
+
+/*
+Carves the maze as independently generated tiles joined into a single tree.
+param target Maze being carved, with every passage closed.
+param strategy Algorithm carving each tile.
+param seed Seed that fully determines the result together with tile_cells.
+param tile_cells Tile side in logical cells, rounded up to a multiple of 32.
+param threads Worker threads carving tiles; values below 1 use one thread.
+ */
+void carve_tiled(carve_target &target, const maze_strategy &strategy, uint64_t seed, int tile_cells, int threads) {
+    const int tile = std::max(32, (tile_cells + 31) / 32 * 32);
+    const int tile_rows = (target.rows() + tile - 1) / tile;
+    const int tile_cols = (target.cols() + tile - 1) / tile;
+    const int tiles = tile_rows * tile_cols;
+
+    auto region_of = [&](int t) {
+        int tr = t / tile_cols, tc = t % tile_cols;
+        return cell_region{tr * tile, tc * tile, std::min((tr + 1) * tile, target.rows()),
+                           std::min((tc + 1) * tile, target.cols())};
+    };
+
+    // Carve every tile; each draws from its own stream, so scheduling does not affect the result
+    std::atomic<int> next_tile(0);
+    auto worker = [&]() {
+        for (int t = next_tile++; t < tiles; t = next_tile++) {
+            maze_rng rng(mix_seed(seed, t));
+            strategy.carve(target, region_of(t), rng);
+        }
+    };
+    const int workers = std::max(1, std::min(threads, tiles));
+    std::vector<std::thread> pool;
+    for (int i = 1; i < workers; ++i)
+        pool.emplace_back(worker);
+    worker();
+    for (std::thread &th : pool)
+        th.join();
+
+    // Join the tiles with a random spanning tree over tile adjacencies (Kruskal)
+    std::vector<tile_join> joins;
+    for (int t = 0; t < tiles; ++t) {
+        if (t % tile_cols + 1 < tile_cols)
+            joins.push_back({t, t + 1, 1});
+        if (t / tile_cols + 1 < tile_rows)
+            joins.push_back({t, t + tile_cols, 2});
+    }
+    maze_rng rng(mix_seed(seed, tiles));
+    rng.shuffle(joins.begin(), joins.end());
+
+    union_find sets(tiles);
+    for (const tile_join &j : joins) {
+        if (!sets.unite(j.a, j.b))
+            continue;
+        // Open one random passage across the shared boundary
+        cell_region a = region_of(j.a);
+        if (j.dir == 1) {
+            int r = a.r0 + int(rng.bounded(a.r1 - a.r0));
+            target.carve(r, a.c1 - 1, 1);
+        } else {
+            int c = a.c0 + int(rng.bounded(a.c1 - a.c0));
+            target.carve(a.r1 - 1, c, 2);
+        }
+    }
+}
+
+}
@@ -0,0 +1,543 @@
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <csignal>
+#include "cli.h"
+#include "maze.h"
+namespace cli_logic {
+
+namespace {
+
+struct maze_size {
+    int width, height;
+};
+
+// Settings of one batch run, filled from the command line.
+struct options {
+    int width = 0, height = 0;
+    std::vector<maze_size> sizes; // Mixed sizes, used in turn instead of width and height
+    int count = 1;
+    bool has_seed = false;
+    uint64_t seed = 0;
+    maze_gen::maze_algorithm algo = maze_gen::maze_algorithm::backtracker;
+    maze_gen::solver_algorithm solver = maze_gen::solver_algorithm::bfs;
+    maze_gen::storage_mode storage = maze_gen::storage_mode::bytes;
+    bool solve = false;
+    bool stream = false;
+    bool play = false;
+    int queries = 0;            // Distance queries per maze through the path index
+    int levels = 0;             // Floors of a layered maze, 0 for a 2D maze
+    bool analyze = false;
+    std::string serve;          // Socket path of server mode, empty for a batch
+    int cache_mb = 256;         // Memory budget of the server's maze cache
+    std::string profile;        // Report format of the phase timers and counters, empty for none
+    std::string out;            // Output path, {i} replaced by the maze index
+    std::string format = "binary";
+    maze_gen::image_options image; // Scale and region of the image formats
+    int threads = 0;            // 0 keeps the generator default
+    int tile = 0;
+    int workers = 1;
+};
+
+void usage(std::ostream &out) {
+    out << R"(Usage: maze_generator [options]      (no options starts the menu)
+    --width N, --height N   Maze size in grid positions, odd numbers greater than 3
+    --sizes WxH,WxH,...     Mixed sizes instead of --width and --height, used in turn
+    --count N               Mazes to generate (default 1)
+    --workers N             Mazes built in parallel, each worker reusing its buffers (default 1)
+    --seed N                Seed of the first maze; maze i uses seed + i (default random)
+    --algo NAME             backtracker, kruskal, prim, eller, wilson, binary_tree, sidewinder
+    --solve                 Solve each maze from entrance to exit
+    --solver NAME           bfs, astar, bidirectional, dfs, parallel (default bfs)
+    --storage MODE          bytes or compact (default bytes)
+    --threads N             Threads for tiled generation and the parallel solver when --workers is 1
+    --tile N                Tile side in cells; enables tiled generation
+    --levels N              Layered maze of N floors of --width by --height joined by stairs
+                            (backtracker; --out writes the lattice format, or text floor by floor)
+    --stream                Generate row by row with Eller's algorithm straight to --out,
+                            in memory proportional to the width
+    --play                  Play the maze with keys from standard input, which may be a pipe of
+                            scripted keys; the result is written to standard error
+    --profile FORMAT        Write phase timers and counters to standard error as text or json
+                            (recorded only in builds configured with -DMAZE_PROFILE=ON)
+    --analyze               Report dead ends, corridors, branching, solution, diameter and difficulty
+    --queries N             Build a path index for each maze and answer N random distance queries
+    --serve PATH            Serve mazes on a Unix socket at PATH until interrupted, with --workers
+                            connections at once (protocol in include/server.h)
+    --cache-mb N            Memory budget of the server's maze cache (default 256)
+    --out PATH              Write each maze; use {i} for the index when --count > 1
+    --format NAME           binary, stored (uncompressed, mapped without decoding), text, or an image: pbm, pgm
+                            or png (with --solve the path is drawn, in red in png)
+    --scale N               Pixels per grid position in images (default 1)
+    --region T,L,R,C        Only draw grid rows T to T+R-1 and columns L to L+C-1 in images
+One JSON object per maze is written to standard output, then a summary.
+)";
+}
+
+bool parse_int(const char *text, int &value) {
+    char *end = nullptr;
+    long v = std::strtol(text, &end, 10);
+    if (end == text || *end != '\0' || v < 0 || v > 0x7FFFFFFF)
+        return false;
+    value = int(v);
+    return true;
+}
+
+/*
+Reads a list such as 21x21,101x51.
+return False unless every entry is a valid odd size greater than 3.
+ */
+bool parse_sizes(const char *text, std::vector<maze_size> &sizes) {
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        maze_size s{0, 0};
+        const size_t x = item.find('x');
+        if (x == std::string::npos || !parse_int(item.substr(0, x).c_str(), s.width) ||
+            !parse_int(item.substr(x + 1).c_str(), s.height) || s.width % 2 == 0 || s.width <= 3 ||
+            s.height % 2 == 0 || s.height <= 3)
+            return false;
+        sizes.push_back(s);
+    }
+    return !sizes.empty();
+}
+
+/*
+Reads a region such as 0,0,101,201: top, left, rows and columns.
+return False unless there are four numbers and the size is not zero.
+ */
+bool parse_region(const char *text, maze_gen::image_options &image) {
+    std::stringstream ss(text);
+    std::string item;
+    int *fields[4] = {&image.top, &image.left, &image.rows, &image.cols};
+    int n = 0;
+    while (std::getline(ss, item, ','))
+        if (n == 4 || !parse_int(item.c_str(), *fields[n++]))
+            return false;
+    return n == 4 && image.rows > 0 && image.cols > 0;
+}
+
+// True if the output format is one of the image formats.
+bool is_image(const options &opts) {
+    maze_gen::image_format format;
+    return maze_gen::parse_image_format(opts.format, format);
+}
+
+/*
+Reads the command line into opts.
+return False after printing a message if an option is unknown or malformed.
+ */
+bool parse(int argc, char **argv, options &opts) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        const char *value = has_value ? argv[i + 1] : "";
+        bool ok = true;
+
+        if (arg == "--solve") {
+            opts.solve = true;
+            continue;
+        } else if (arg == "--stream") {
+            opts.stream = true;
+            continue;
+        } else if (arg == "--analyze") {
+            opts.analyze = true;
+            continue;
+        } else if (arg == "--play") {
+            opts.play = true;
+            continue;
+        } else if (arg == "--help" || arg == "-h") {
+            usage(std::cout);
+            std::exit(0);
+        } else if (!has_value) {
+            std::cerr << "Unknown option or missing value: " << arg << std::endl;
+            return false;
+        } else if (arg == "--width") {
+            ok = parse_int(value, opts.width);
+        } else if (arg == "--height") {
+            ok = parse_int(value, opts.height);
+        } else if (arg == "--count") {
+            ok = parse_int(value, opts.count);
+        } else if (arg == "--workers") {
+            ok = parse_int(value, opts.workers) && opts.workers > 0;
+        } else if (arg == "--sizes") {
+            ok = parse_sizes(value, opts.sizes);
+        } else if (arg == "--threads") {
+            ok = parse_int(value, opts.threads) && opts.threads > 0;
+        } else if (arg == "--tile") {
+            ok = parse_int(value, opts.tile);
+        } else if (arg == "--seed") {
+            char *end = nullptr;
+            opts.seed = std::strtoull(value, &end, 10);
+            opts.has_seed = true;
+            ok = end != value && *end == '\0';
+        } else if (arg == "--algo") {
+            ok = maze_gen::parse_algorithm(value, opts.algo);
+        } else if (arg == "--solver") {
+            ok = maze_gen::parse_solver(value, opts.solver);
+        } else if (arg == "--storage") {
+            ok = std::string(value) == "bytes" || std::string(value) == "compact";
+            opts.storage = std::string(value) == "compact" ? maze_gen::storage_mode::compact : maze_gen::storage_mode::bytes;
+        } else if (arg == "--out") {
+            opts.out = value;
+        } else if (arg == "--levels") {
+            ok = parse_int(value, opts.levels) && opts.levels > 0;
+        } else if (arg == "--serve") {
+            opts.serve = value;
+        } else if (arg == "--cache-mb") {
+            ok = parse_int(value, opts.cache_mb);
+        } else if (arg == "--queries") {
+            ok = parse_int(value, opts.queries);
+        } else if (arg == "--profile") {
+            opts.profile = value;
+            ok = opts.profile == "text" || opts.profile == "json";
+        } else if (arg == "--format") {
+            opts.format = value;
+            ok = opts.format == "binary" || opts.format == "stored" || opts.format == "text" ||
+                 maze_gen::parse_image_format(value, opts.image.format);
+        } else if (arg == "--scale") {
+            ok = parse_int(value, opts.image.scale) && opts.image.scale > 0;
+        } else if (arg == "--region") {
+            ok = parse_region(value, opts.image);
+        } else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return false;
+        }
+        if (!ok) {
+            std::cerr << "Invalid value for " << arg << ": " << value << std::endl;
+            return false;
+        }
+        ++i;
+    }
+
+    if (!opts.serve.empty())
+        return true; // Clients choose the mazes
+    if (!opts.sizes.empty() && opts.stream) {
+        std::cerr << "--stream takes --width and --height, not --sizes" << std::endl;
+        return false;
+    }
+    if (opts.sizes.empty() && (opts.width % 2 == 0 || opts.width <= 3 || opts.height % 2 == 0 || opts.height <= 3)) {
+        std::cerr << "--width and --height must be odd numbers greater than 3" << std::endl;
+        return false;
+    }
+    if (opts.count > 1 && !opts.out.empty() && opts.out.find("{i}") == std::string::npos) {
+        std::cerr << "--out needs {i} in the path when --count is greater than 1" << std::endl;
+        return false;
+    }
+    if (opts.play && (opts.stream || !opts.sizes.empty() || opts.count != 1)) {
+        std::cerr << "--play takes a single maze of --width by --height" << std::endl;
+        return false;
+    }
+    if ((opts.image.scale != 1 || opts.image.rows > 0) && !is_image(opts)) {
+        std::cerr << "--scale and --region apply to the image formats pbm, pgm and png" << std::endl;
+        return false;
+    }
+    if (opts.levels > 0 && is_image(opts)) {
+        std::cerr << "--levels writes the lattice format or text, not images" << std::endl;
+        return false;
+    }
+    if (opts.levels > 0 && (opts.stream || opts.play || !opts.sizes.empty() || opts.queries || opts.analyze ||
+                            opts.algo != maze_gen::maze_algorithm::backtracker)) {
+        std::cerr << "--levels builds backtracker mazes of --width by --height; it cannot be combined with --stream, "
+                     "--play, --sizes, --queries or --analyze" << std::endl;
+        return false;
+    }
+    if (opts.stream) {
+        if (opts.solve || opts.queries || opts.analyze) {
+            std::cerr << "--stream does not keep the maze, so it cannot be combined with --solve, --queries or --analyze" << std::endl;
+            return false;
+        }
+        opts.algo = maze_gen::maze_algorithm::eller; // Streaming is Eller's algorithm
+    }
+    return true;
+}
+
+// Output path of maze i.
+std::string output_path(const std::string &pattern, int i) {
+    std::string path = pattern;
+    size_t at = path.find("{i}");
+    if (at != std::string::npos)
+        path.replace(at, 3, std::to_string(i));
+    return path;
+}
+
+// Writes each finished maze to its numbered output path, on the worker that built it.
+class file_writer : public maze_gen::batch_consumer {
+    std::string pattern_, format_;
+    maze_gen::image_options image_;
+
+public:
+    file_writer(const std::string &pattern, const std::string &format, const maze_gen::image_options &image)
+        : pattern_(pattern), format_(format), image_(image) {}
+
+    bool consume(size_t index, const maze_gen::batch_job &job, maze_gen::maze_generator &generator) override {
+        const std::string path = output_path(pattern_, int(index));
+        bool written;
+        maze_gen::image_format format;
+        if (maze_gen::parse_image_format(format_, format)) {
+            generator.set_solver(job.solver);
+            written = generator.save_image(path, image_, job.solve);
+        } else if (format_ == "text") {
+            std::ofstream file(path);
+            maze_gen::text_sink sink(file);
+            generator.write_rows(sink);
+            written = sink.ok();
+        } else {
+            written = generator.save(path);
+        }
+        if (!written)
+            std::cerr << "Could not write " << path << std::endl;
+        return written;
+    }
+};
+
+// Quotes a string for JSON output.
+std::string json_string(const std::string &s) {
+    std::string res = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\')
+            res += '\\';
+        if (static_cast<unsigned char>(c) < 0x20)
+            continue;
+        res += c;
+    }
+    return res + "\"";
+}
+
+double elapsed_ms(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+}
+
+// Server of --serve, stopped by SIGINT and SIGTERM
+maze_gen::maze_server *serving = nullptr;
+
+void stop_serving(int) {
+    if (serving)
+        serving->stop();
+}
+
+// Writes the profile report requested with --profile, if any.
+void report_profile(const options &opts) {
+    if (opts.profile == "json")
+        maze_gen::profile::write_json(std::cerr);
+    else if (opts.profile == "text")
+        maze_gen::profile::write_text(std::cerr);
+}
+
+}
+
+/*
+Runs a batch of mazes described by the command line without any prompts.
+Mazes are built by maze_batch, whose workers reuse their buffers from maze to maze.
+param argc, argv Arguments of main.
+return Process exit code: 0 on success, 1 on bad usage, 2 if a maze could not be written.
+ */
+int run(int argc, char **argv) {
+    options opts;
+    if (!parse(argc, argv, opts)) {
+        usage(std::cerr);
+        return 1;
+    }
+
+    // Seeds are fixed up front so every maze is reproducible from its line of output
+    std::vector<uint64_t> seeds(opts.count);
+    for (int i = 0; i < opts.count; ++i)
+        seeds[i] = opts.has_seed ? opts.seed + uint64_t(i)
+                                 : (uint64_t(std::random_device{}()) << 32) | std::random_device{}();
+
+    if (!opts.serve.empty()) {
+        maze_gen::server_options settings;
+        settings.workers = opts.workers;
+        settings.cache_bytes = size_t(opts.cache_mb) << 20;
+        settings.storage = opts.storage;
+        maze_gen::maze_server server(settings);
+        std::string error;
+        if (!server.listen(opts.serve, error)) {
+            std::cerr << "Cannot serve: " << error << std::endl;
+            return 1;
+        }
+        serving = &server;
+        std::signal(SIGINT, stop_serving);
+        std::signal(SIGTERM, stop_serving);
+        std::cerr << "Serving on " << opts.serve << std::endl;
+        server.run();
+        serving = nullptr;
+        std::cout << "{\"summary\":true,\"cache\":";
+        maze_gen::write_json(std::cout, server.stats());
+        std::cout << "}" << std::endl;
+        report_profile(opts);
+        return 0;
+    }
+
+    if (opts.play) {
+        maze_gen::maze_generator M(opts.width, opts.height);
+        M.set_verbose(false);
+        M.set_storage(opts.storage);
+        M.set_algorithm(opts.algo);
+        M.set_seed(seeds[0]);
+        M.generate_maze();
+        const maze_gen::play_stats played = M.play(STDIN_FILENO, STDOUT_FILENO);
+        std::cerr << "{\"seed\":" << seeds[0] << ",\"escaped\":" << (played.escaped ? "true" : "false")
+                  << ",\"moves\":" << played.moves << ",\"keys\":" << played.keys << ",\"frames\":" << played.frames
+                  << ",\"x\":" << played.x << ",\"y\":" << played.y << "}" << std::endl;
+        report_profile(opts);
+        return 0;
+    }
+
+    const auto batch_start = std::chrono::steady_clock::now();
+    int failures = 0;
+    if (opts.levels > 0) {
+        // Cells along floor, row and column, as the 2D options count them per floor
+        maze_gen::lattice<3> layered;
+        if (!layered.assign({opts.levels, (opts.height - 1) / 2, (opts.width - 1) / 2})) {
+            std::cerr << "--levels " << opts.levels << " of " << opts.width << "x" << opts.height
+                      << " is not supported: a layered maze holds fewer than 2^32 cells" << std::endl;
+            return 1;
+        }
+        for (int i = 0; i < opts.count; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            layered.generate(seeds[i]);
+            const double generate_ms = elapsed_ms(start);
+            std::cout << "{\"maze\":" << i << ",\"seed\":" << seeds[i] << ",\"width\":" << opts.width
+                      << ",\"height\":" << opts.height << ",\"levels\":" << opts.levels
+                      << ",\"algo\":\"backtracker\",\"generate_ms\":" << generate_ms;
+            maze_gen::lattice_path solved;
+            if (opts.solve) {
+                solved = layered.solve();
+                size_t stairs = 0;
+                for (size_t k = 1; k < solved.cells.size(); ++k)
+                    stairs += std::max(solved.cells[k], solved.cells[k - 1]) -
+                              std::min(solved.cells[k], solved.cells[k - 1]) == layered.stride(0);
+                std::cout << ",\"solved\":" << (solved.found ? "true" : "false") << ",\"path_cells\":"
+                          << solved.cells.size() << ",\"stairs\":" << stairs << ",\"nodes_expanded\":"
+                          << solved.stats.nodes_expanded << ",\"solve_ms\":" << solved.stats.elapsed_ms;
+            }
+            if (!opts.out.empty()) {
+                const std::string path = output_path(opts.out, i);
+                std::string error;
+                bool written;
+                start = std::chrono::steady_clock::now();
+                if (opts.format == "text") {
+                    std::ofstream file(path);
+                    maze_gen::write_text(file, layered, opts.solve ? &solved : nullptr);
+                    written = bool(file);
+                } else {
+                    written = layered.save(path, error);
+                }
+                if (!written) {
+                    std::cerr << "Could not write " << path << std::endl;
+                    ++failures;
+                }
+                std::cout << ",\"write_ms\":" << elapsed_ms(start) << ",\"out\":" << json_string(path)
+                          << ",\"written\":" << (written ? "true" : "false");
+            }
+            std::cout << "}\n";
+        }
+        const double total_ms = elapsed_ms(batch_start);
+        std::cout << "{\"summary\":true,\"count\":" << opts.count << ",\"failures\":" << failures
+                  << ",\"total_ms\":" << total_ms << ",\"mazes_per_sec\":" << opts.count * 1000.0 / total_ms << "}"
+                  << std::endl;
+        report_profile(opts);
+        return failures ? 2 : 0;
+    }
+    if (opts.stream) {
+        maze_gen::maze_generator M(opts.width, opts.height);
+        M.set_verbose(false);
+        for (int i = 0; i < opts.count; ++i) {
+            M.set_seed(seeds[i]);
+            const std::string path = opts.out.empty() ? std::string() : output_path(opts.out, i);
+            bool written = true;
+
+            // Generation and writing are one pass; without --out the rows are only generated
+            auto start = std::chrono::steady_clock::now();
+            if (path.empty()) {
+                std::ostream discard(nullptr);
+                maze_gen::text_sink sink(discard);
+                M.stream_maze(sink);
+            } else if (opts.format == "text") {
+                std::ofstream file(path);
+                maze_gen::text_sink sink(file);
+                M.stream_maze(sink);
+                written = sink.ok();
+            } else if (is_image(opts)) {
+                std::ofstream file(path, std::ios::binary);
+                maze_gen::image_sink sink(file, opts.image);
+                M.stream_maze(sink);
+                written = sink.ok();
+            } else {
+                maze_gen::file_sink sink(path, path, opts.format != "stored");
+                M.stream_maze(sink);
+                written = sink.ok();
+            }
+            const double generate_ms = elapsed_ms(start);
+            if (!written) {
+                std::cerr << "Could not write " << path << std::endl;
+                ++failures;
+            }
+            std::cout << "{\"maze\":" << i << ",\"seed\":" << seeds[i] << ",\"width\":" << opts.width
+                      << ",\"height\":" << opts.height << ",\"algo\":\"eller\",\"generate_ms\":" << generate_ms;
+            if (!path.empty())
+                std::cout << ",\"out\":" << json_string(path);
+            std::cout << "}\n";
+        }
+        const double total_ms = elapsed_ms(batch_start);
+        std::cout << "{\"summary\":true,\"count\":" << opts.count << ",\"failures\":" << failures
+                  << ",\"total_ms\":" << total_ms << ",\"mazes_per_sec\":" << opts.count * 1000.0 / total_ms << "}"
+                  << std::endl;
+        report_profile(opts);
+        return failures ? 2 : 0;
+    }
+
+    std::vector<maze_gen::batch_job> jobs(opts.count);
+    for (int i = 0; i < opts.count; ++i) {
+        const maze_size &size = opts.sizes.empty() ? maze_size{opts.width, opts.height} : opts.sizes[i % opts.sizes.size()];
+        jobs[i] = maze_gen::batch_job(size.width, size.height, opts.algo, seeds[i]);
+        jobs[i].solve = opts.solve;
+        jobs[i].solver = opts.solver;
+        jobs[i].queries = size_t(opts.queries);
+        jobs[i].analyze = opts.analyze;
+    }
+
+    // Tiles only help one large maze; with several workers each maze is built on one thread
+    maze_gen::maze_batch batch(opts.workers, opts.storage);
+    batch.set_tile_size(opts.tile);
+    if (opts.workers == 1)
+        batch.set_tile_threads(opts.threads);
+    batch.set_compression(opts.format != "stored");
+    maze_gen::image_options image = opts.image;
+    if (opts.workers > 1)
+        image.threads = 1; // The workers already keep the cores busy
+    file_writer writer(opts.out, opts.format, image);
+    std::vector<maze_gen::batch_result> results;
+    maze_gen::batch_stats stats = batch.run(jobs, results, opts.out.empty() ? nullptr : &writer);
+
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        const maze_gen::batch_job &job = jobs[i];
+        const maze_gen::batch_result &res = results[i];
+        std::cout << "{\"maze\":" << i << ",\"seed\":" << job.seed << ",\"width\":" << job.width
+                  << ",\"height\":" << job.height << ",\"algo\":\"" << maze_gen::algorithm_name(job.algo)
+                  << "\",\"worker\":" << res.worker << ",\"generate_ms\":" << res.generate_ms;
+        if (!opts.out.empty())
+            std::cout << ",\"write_ms\":" << res.consume_ms << ",\"out\":" << json_string(output_path(opts.out, int(i)))
+                      << ",\"written\":" << (res.ok ? "true" : "false");
+        if (job.solve)
+            std::cout << ",\"solver\":\"" << maze_gen::solver_name(job.solver) << "\",\"solved\":"
+                      << (res.solved ? "true" : "false") << ",\"path_cells\":" << res.path_cells
+                      << ",\"nodes_expanded\":" << res.nodes_expanded << ",\"solve_ms\":" << res.solve_ms;
+        if (job.analyze) {
+            std::cout << ",\"analysis\":";
+            maze_gen::write_json(std::cout, res.analysis);
+        }
+        if (job.queries)
+            std::cout << ",\"index_ms\":" << res.index_ms << ",\"queries\":" << job.queries
+                      << ",\"query_ns\":" << res.query_ms * 1e6 / job.queries << ",\"distance_sum\":" << res.distance_sum;
+        std::cout << "}\n";
+    }
+    std::cout << "{\"summary\":true,\"count\":" << stats.mazes << ",\"failures\":" << stats.failures
+              << ",\"workers\":" << batch.workers() << ",\"total_ms\":" << stats.elapsed_ms
+              << ",\"mazes_per_sec\":" << stats.mazes_per_sec << ",\"cells_per_sec\":" << stats.cells_per_sec << "}"
+              << std::endl;
+    report_profile(opts);
+    return stats.failures ? 2 : 0;
+}
+}
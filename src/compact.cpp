@@ -0,0 +1,107 @@
+#include "maze.h"
+
+namespace maze_gen {
+
+/*
+Writes grid row x as WALL/CELL characters, matching what maze::grid would hold.
+param x Grid row to expand.
+param out Buffer of at least width() characters.
+ */
+void compact_walls::expand_row(int x, char *out) const {
+    std::fill(out, out + width_, WALL);
+    if (x == 0) {
+        out[1] = CELL;                 // Entrance
+    } else if (x == height_ - 1) {
+        out[width_ - 2] = CELL;        // Exit
+    } else if (x % 2 == 1) {
+        // Cell row: cells at odd columns, east passages between them. Passages are
+        // random, so each is computed rather than branched on
+        const uint64_t *words = bits_.row_words(x / 2);
+        for (int c = 0; c < cols(); ++c) {
+            const int v = int(words[c / 32] >> (2 * (c % 32)));
+            out[2 * c + 1] = CELL;
+            out[2 * c + 2] = char(WALL + (CELL - WALL) * (v & east));
+        }
+    } else {
+        // Wall row: south passages of the cell row above
+        const uint64_t *words = bits_.row_words(x / 2 - 1);
+        for (int c = 0; c < cols(); ++c)
+            out[2 * c + 1] = char(WALL + (CELL - WALL) * (int(words[c / 32] >> (2 * (c % 32) + 1)) & 1));
+    }
+}
+
+/*
+Reads the passages of grid row x from WALL/CELL characters.
+Cells, corners and the border are implied by the layout, so only passages are kept.
+param x Grid row being packed.
+param in Row of width() characters.
+ */
+void compact_walls::pack_row(int x, const char *in) {
+    if (x <= 0 || x >= height_ - 1)
+        return;
+    if (x % 2 == 1) {
+        const int r = x / 2;
+        for (int c = 0; c + 1 < cols(); ++c)
+            if (in[2 * c + 2] != WALL)
+                open(r, c, east);
+    } else {
+        const int r = x / 2 - 1;
+        for (int c = 0; c < cols(); ++c)
+            if (in[2 * c + 1] != WALL)
+                open(r, c, south);
+    }
+}
+
+/*
+Opens in overlay the passage of every step of a path.
+param path Cells from start to goal, each next to the one before.
+param overlay Assigned to the maze size beforehand.
+ */
+void trace_path(const std::vector<cell> &path, compact_walls &overlay) {
+    for (size_t i = 1; i < path.size(); ++i) {
+        const cell &a = path[i - 1], &b = path[i];
+        int d = b.x < a.x ? 0 : b.y > a.y ? 1 : b.x > a.x ? 2 : 3;
+        overlay.carve(a.x / 2, a.y / 2, d);
+    }
+}
+
+// Marks the cells and passages of grid row x that a path overlay uses with PATH.
+// Words of 32 cells the path does not touch are skipped whole.
+void mark_path_row(const compact_walls &overlay, int x, char *row) {
+    if (x <= 0 || x >= overlay.height() - 1)
+        return;
+    const int cols = overlay.cols();
+    const size_t row_words = overlay.plane().words_per_row();
+    if (x % 2 == 1) {
+        const int r = x / 2;
+        const uint64_t *cur = overlay.plane().row_words(r);
+        const uint64_t *up = r > 0 ? overlay.plane().row_words(r - 1) : nullptr;
+        for (size_t w = 0; w < row_words; ++w) {
+            const bool west = w > 0 && (cur[w - 1] >> 62 & compact_walls::east); // Into the word's first cell
+            if (!cur[w] && !(up && up[w]) && !west)
+                continue;
+            const int end = std::min(cols, int(w + 1) * 32);
+            for (int c = int(w) * 32; c < end; ++c) {
+                unsigned links = overlay.get(r, c);
+                if (links || (c > 0 && (overlay.get(r, c - 1) & compact_walls::east)) ||
+                    (r > 0 && (overlay.get(r - 1, c) & compact_walls::south)))
+                    row[2 * c + 1] = PATH;
+                if (links & compact_walls::east)
+                    row[2 * c + 2] = PATH;
+            }
+        }
+    } else {
+        const int r = x / 2 - 1;
+        const uint64_t *cur = overlay.plane().row_words(r);
+        for (size_t w = 0; w < row_words; ++w) {
+            if (!(cur[w] & 0xAAAAAAAAAAAAAAAAull)) // No south passage in the word
+                continue;
+            const int end = std::min(cols, int(w + 1) * 32);
+            for (int c = int(w) * 32; c < end; ++c)
+                if (overlay.get(r, c) & compact_walls::south)
+                    row[2 * c + 1] = PATH;
+        }
+    }
+}
+
+}
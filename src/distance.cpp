@@ -0,0 +1,318 @@
+#include "maze.h"
+#include <chrono>
+#include <cstring>
+
+namespace maze_gen {
+
+namespace {
+
+const uint32_t NONE = 0xFFFFFFFFu;
+
+// Open passages of logical cell (r, c): bit 0 east, bit 1 south, as in compact_walls.
+template <typename View>
+unsigned passages(const View &maze, int r, int c, int rows, int cols) {
+    return unsigned(c + 1 < cols && !maze.is_wall(2 * r + 1, 2 * c + 2)) |
+           unsigned(r + 1 < rows && !maze.is_wall(2 * r + 2, 2 * c + 1)) << 1;
+}
+
+/*
+Writes an array as little-endian words through a bounded buffer, adding it to a running CRC.
+return False if the stream failed.
+ */
+bool write_words(std::ostream &out, const std::vector<uint32_t> &words, uint32_t &crc) {
+    unsigned char buffer[4096];
+    for (size_t i = 0; i < words.size();) {
+        size_t n = std::min(words.size() - i, sizeof(buffer) / 4);
+        for (size_t k = 0; k < n; ++k)
+            put_u32(buffer + 4 * k, words[i + k]);
+        crc = crc32(buffer, 4 * n, crc);
+        out.write(reinterpret_cast<const char *>(buffer), std::streamsize(4 * n));
+        i += n;
+    }
+    return bool(out);
+}
+
+bool read_words(std::istream &in, std::vector<uint32_t> &words, size_t count, uint32_t &crc) {
+    unsigned char buffer[4096];
+    words.resize(count);
+    for (size_t i = 0; i < count;) {
+        size_t n = std::min(count - i, sizeof(buffer) / 4);
+        if (!in.read(reinterpret_cast<char *>(buffer), std::streamsize(4 * n)))
+            return false;
+        crc = crc32(buffer, 4 * n, crc);
+        for (size_t k = 0; k < n; ++k)
+            words[i + k] = get_u32(buffer + 4 * k);
+        i += n;
+    }
+    return true;
+}
+
+}
+
+template <typename View>
+uint32_t maze_fingerprint(const View &maze) {
+    const int rows = (maze.height() - 1) / 2, cols = (maze.width() - 1) / 2;
+    std::vector<unsigned char> row(cols);
+    uint32_t crc = 0;
+    for (int r = 0; r < rows; ++r) {
+        for (int c = 0; c < cols; ++c)
+            row[c] = (unsigned char)passages(maze, r, c, rows, cols);
+        crc = crc32(row.data(), row.size(), crc);
+    }
+    return crc;
+}
+
+/*
+Builds the index for a perfect maze.
+param maze View answering is_wall(x, y) on grid positions.
+param error Receives a message when the maze is not a tree over all of its cells.
+return True if the index is ready for queries.
+ */
+template <typename View>
+bool distance_index::build(const View &maze, std::string &error) {
+    clear();
+    const int rows = (maze.height() - 1) / 2, cols = (maze.width() - 1) / 2;
+    const size_t n = size_t(rows) * cols;
+    if (rows < 1 || cols < 1 || n >= NONE) {
+        error = "maze size not supported by the distance index";
+        return false;
+    }
+
+    // Breadth-first pass from the entrance cell: parents, depths and the visiting order
+    std::vector<uint32_t> order(n);
+    parent_.assign(n, NONE);
+    depth_.assign(n, 0);
+    parent_[0] = 0;
+    order[0] = 0;
+    size_t reached = 1, edges = 0;
+    for (size_t i = 0; i < reached; ++i) {
+        const uint32_t v = order[i];
+        const int r = int(v / cols), c = int(v % cols);
+        const unsigned open = passages(maze, r, c, rows, cols);
+        edges += (open & 1) + (open >> 1);
+        uint32_t next[4];
+        int count = 0;
+        if (open & 1)
+            next[count++] = v + 1;
+        if (open & 2)
+            next[count++] = v + uint32_t(cols);
+        if (c > 0 && !maze.is_wall(2 * r + 1, 2 * c))
+            next[count++] = v - 1;
+        if (r > 0 && !maze.is_wall(2 * r, 2 * c + 1))
+            next[count++] = v - uint32_t(cols);
+        for (int k = 0; k < count; ++k) {
+            if (parent_[next[k]] != NONE)
+                continue;
+            parent_[next[k]] = v;
+            depth_[next[k]] = depth_[v] + 1;
+            order[reached++] = next[k];
+        }
+    }
+    if (reached != n || edges != n - 1) {
+        error = reached != n ? "maze has cells that cannot be reached from the entrance"
+                             : "maze has loops, so paths between cells are not unique";
+        clear();
+        return false;
+    }
+
+    // Subtree sizes in reverse order pick each cell's heavy child, the one with the largest subtree
+    std::vector<uint32_t> size(n, 1), heavy(n, NONE);
+    for (size_t i = n - 1; i > 0; --i) {
+        const uint32_t v = order[i], p = parent_[v];
+        size[p] += size[v];
+        if (heavy[p] == NONE || size[v] > size[heavy[p]])
+            heavy[p] = v;
+    }
+    // A heavy child continues its parent's path; every other cell starts a new one
+    head_.assign(n, 0);
+    for (size_t i = 1; i < n; ++i) {
+        const uint32_t v = order[i], p = parent_[v];
+        head_[v] = heavy[p] == v ? head_[p] : v;
+    }
+
+    height_ = maze.height();
+    width_ = maze.width();
+    cols_ = cols;
+    fingerprint_ = maze_fingerprint(maze);
+    return true;
+}
+
+void distance_index::clear() {
+    height_ = width_ = cols_ = 0;
+    fingerprint_ = 0;
+    parent_ = std::vector<uint32_t>();
+    depth_ = std::vector<uint32_t>();
+    head_ = std::vector<uint32_t>();
+}
+
+bool distance_index::contains(const cell &c) const {
+    return !empty() && c.x % 2 == 1 && c.y % 2 == 1 && c.x < unsigned(height_ - 1) && c.y < unsigned(width_ - 1);
+}
+
+// Lowest common ancestor: climbs whole heavy paths until both cells are on the same one.
+uint32_t distance_index::ancestor(uint32_t a, uint32_t b) const {
+    while (head_[a] != head_[b]) {
+        if (depth_[head_[a]] > depth_[head_[b]])
+            a = parent_[head_[a]];
+        else
+            b = parent_[head_[b]];
+    }
+    return depth_[a] < depth_[b] ? a : b;
+}
+
+size_t distance_index::distance(const cell &a, const cell &b) const {
+    if (!contains(a) || !contains(b))
+        return npos;
+    const uint32_t u = id_of(a), v = id_of(b);
+    return size_t(depth_[u]) + depth_[v] - 2 * size_t(depth_[ancestor(u, v)]);
+}
+
+/*
+Lists the cells from a to b: up from a to the common ancestor, then down to b.
+Costs O(log n) plus the length of the path.
+ */
+solve_result distance_index::path(const cell &a, const cell &b) const {
+    solve_result res;
+    if (!contains(a) || !contains(b))
+        return res;
+    const auto begin = std::chrono::steady_clock::now();
+    uint32_t u = id_of(a), v = id_of(b);
+    const uint32_t top = ancestor(u, v);
+
+    res.path.reserve(size_t(depth_[u]) + depth_[v] - 2 * size_t(depth_[top]) + 1);
+    for (; u != top; u = parent_[u])
+        res.path.push_back(cell_of(u));
+    res.path.push_back(cell_of(top));
+    const size_t split = res.path.size();
+    for (; v != top; v = parent_[v])
+        res.path.push_back(cell_of(v));
+    std::reverse(res.path.begin() + split, res.path.end());
+
+    res.found = true;
+    res.stats.nodes_expanded = res.path.size();
+    res.stats.elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    return res;
+}
+
+/*
+Writes the index in the sidecar format described in distance.h.
+return True if the file was written.
+ */
+bool distance_index::save(const std::string &filename, std::string &error) const {
+    if (empty()) {
+        error = "no index has been built";
+        return false;
+    }
+    std::ofstream file(filename, std::ios::binary);
+    if (!file) {
+        error = "cannot open " + filename;
+        return false;
+    }
+    unsigned char header[24];
+    std::memcpy(header, INDEX_MAGIC, 4);
+    put_u16(header + 4, INDEX_VERSION);
+    put_u16(header + 6, 0);
+    put_u32(header + 8, uint32_t(height_));
+    put_u32(header + 12, uint32_t(width_));
+    put_u32(header + 16, fingerprint_);
+    put_u32(header + 20, uint32_t(parent_.size()));
+    file.write(reinterpret_cast<const char *>(header), sizeof(header));
+
+    uint32_t crc = 0;
+    write_words(file, parent_, crc);
+    write_words(file, depth_, crc);
+    write_words(file, head_, crc);
+    unsigned char tail[4];
+    put_u32(tail, crc);
+    file.write(reinterpret_cast<const char *>(tail), 4);
+    if (!file) {
+        error = "error writing " + filename;
+        return false;
+    }
+    return true;
+}
+
+/*
+Reads an index written by save(). The header must describe the maze and the file
+must be long enough before any array is allocated, and the arrays must form a tree
+rooted at the entrance, so a damaged file cannot make ancestor() loop.
+param height, width Grid size of the maze the index is for.
+param fingerprint maze_fingerprint of the maze the index is for.
+param error Receives a message if the file is unusable; left empty when there is no file.
+return True if the file was complete, intact and built for that maze.
+ */
+bool distance_index::load(const std::string &filename, int height, int width, uint32_t fingerprint,
+                          std::string &error) {
+    clear();
+    std::ifstream file(filename, std::ios::binary);
+    if (!file) {
+        error.clear(); // No index saved, which is not an error
+        return false;
+    }
+    unsigned char header[24];
+    if (!file.read(reinterpret_cast<char *>(header), sizeof(header)) || std::memcmp(header, INDEX_MAGIC, 4) != 0) {
+        error = "not a distance index file";
+        return false;
+    }
+    if (get_u16(header + 4) != INDEX_VERSION) {
+        error = "unsupported distance index version " + std::to_string(get_u16(header + 4));
+        return false;
+    }
+    const size_t n = get_u32(header + 20);
+    if (get_u32(header + 8) != uint32_t(height) || get_u32(header + 12) != uint32_t(width) || height < 3 ||
+        width < 3 || n != size_t((height - 1) / 2) * ((width - 1) / 2)) {
+        error = "distance index header does not match the maze";
+        return false;
+    }
+    if (get_u32(header + 16) != fingerprint) {
+        error = "distance index was built for a different maze";
+        return false;
+    }
+
+    if (stream_bytes_left(file) < 12 * uint64_t(n) + 4) {
+        error = "distance index is truncated";
+        return false;
+    }
+
+    uint32_t crc = 0;
+    unsigned char tail[4];
+    if (!read_words(file, parent_, n, crc) || !read_words(file, depth_, n, crc) || !read_words(file, head_, n, crc) ||
+        !file.read(reinterpret_cast<char *>(tail), 4)) {
+        error = "distance index is truncated";
+        clear();
+        return false;
+    }
+    if (get_u32(tail) != crc) {
+        error = "distance index checksum mismatch";
+        clear();
+        return false;
+    }
+    // Depths fall by one towards the root and each cell continues at most one child's heavy path
+    std::vector<unsigned char> continued(n, 0);
+    bool ok = parent_[0] == 0 && depth_[0] == 0 && head_[0] == 0;
+    for (size_t v = 1; ok && v < n; ++v) {
+        const uint32_t p = parent_[v];
+        ok = p < n && head_[v] < n && depth_[p] + 1 == depth_[v] &&
+             (head_[v] == v || (head_[v] == head_[p] && !continued[p]++));
+    }
+    if (!ok) {
+        error = "distance index is corrupt";
+        clear();
+        return false;
+    }
+
+    height_ = height;
+    width_ = width;
+    cols_ = (width - 1) / 2;
+    fingerprint_ = fingerprint;
+    return true;
+}
+
+template uint32_t maze_fingerprint<grid_view>(const grid_view &);
+template uint32_t maze_fingerprint<compact_walls>(const compact_walls &);
+template uint32_t maze_fingerprint<mapped_maze>(const mapped_maze &);
+template bool distance_index::build<grid_view>(const grid_view &, std::string &);
+template bool distance_index::build<compact_walls>(const compact_walls &, std::string &);
+template bool distance_index::build<mapped_maze>(const mapped_maze &, std::string &);
+
+}
@@ -27,7 +27,10 @@ Maze Generator
     4. Load maze
     5. Solve maze
     6. Solve maze yourself
-    7. Exit)" << std::endl;
+    7. Exit
+    8. Inspect region of saved maze
+    9. Show profile counters
+    10. Analyze maze)" << std::endl;
 }
 
  //Runs the main loop of the maze generator program, handling user input and menu navigation.
@@ -88,6 +91,41 @@ int run(){
         case 7:
             // Exit the program
             continue;
+        case 8:{
+            // Map a saved maze and show part of it without loading the whole file
+            std::cout<<"Enter the file name:" << std::endl;
+            std::string filename;
+            std::cin >> filename;
+            std::cout<<"Enter top row, left column, rows and columns:" << std::endl;
+            int top = 0, left = 0, rows = 0, cols = 0;
+            std::cin >> top >> left >> rows >> cols;
+            if (!std::cin) {
+                std::cin.clear();
+                std::cin.ignore(10000, '\n');
+            }
+            clear_screen();
+            M.inspect(filename, top, left, rows, cols);
+            display_menu();
+            }
+            break;
+        case 9:{
+            // Dump the phase timers and counters gathered since start-up
+            std::cout<<"Enter the format (text or json):" << std::endl;
+            std::string format;
+            std::cin >> format;
+            clear_screen();
+            if (format == "json")
+                maze_gen::profile::write_json(std::cout);
+            else
+                maze_gen::profile::write_text(std::cout);
+            display_menu();
+            }
+            break;
+        case 10:
+            // Report the structure and difficulty of the current maze
+            maze_gen::write_text(std::cout, M.get_maze().height > 0 ? M.analyze() : maze_gen::maze_analysis());
+            display_menu();
+            break;
         default: 
             std::cout << "Please try again" << std::endl;
             std::cin.clear();
@@ -0,0 +1,235 @@
+#include "maze.h"
+#include <chrono>
+#include <queue>
+
+namespace maze_gen {
+
+namespace {
+
+const uint32_t FAR = 0xFFFFFFFFu; // Distance of an unreachable cell
+
+// States of a cell in mark_ while close() runs
+enum : unsigned char { UNSEEN = 0, CHECKED = 1, LOST = 2 };
+
+}
+
+template <typename View>
+void distance_field::build(const View &maze) {
+    height_ = maze.height();
+    width_ = maze.width();
+    rows_ = (height_ - 1) / 2;
+    cols_ = (width_ - 1) / 2;
+    const size_t n = size_t(rows_) * cols_;
+    open_.resize(n);
+    for (int r = 0; r < rows_; ++r)
+        for (int c = 0; c < cols_; ++c)
+            open_[size_t(r) * cols_ + c] = (unsigned char)open_mask(maze, r, c, rows_, cols_);
+
+    dist_.assign(n, FAR);
+    mark_.assign(n, UNSEEN);
+    queue_.resize(n);
+    size_t tail = 0;
+    dist_[0] = 0;
+    queue_[tail++] = 0;
+    for (size_t head = 0; head < tail; ++head) {
+        const uint32_t v = queue_[head];
+        for (int d = 0; d < 4; ++d)
+            if (open_[v] >> d & 1) {
+                const uint32_t u = step(v, d);
+                if (dist_[u] == FAR) {
+                    dist_[u] = dist_[v] + 1;
+                    queue_[tail++] = u;
+                }
+            }
+    }
+    touched_ = tail;
+}
+
+void distance_field::clear() {
+    height_ = width_ = rows_ = cols_ = 0;
+    open_ = std::vector<unsigned char>();
+    dist_ = std::vector<uint32_t>();
+    mark_ = std::vector<unsigned char>();
+    queue_ = std::vector<uint32_t>();
+    lost_ = std::vector<uint32_t>();
+    touched_ = 0;
+}
+
+uint32_t distance_field::step(uint32_t v, int dir) const {
+    return uint32_t(int64_t(v) + dir_row[dir] * int64_t(cols_) + dir_col[dir]);
+}
+
+// Ids of the two cells on either side of a wall, if it is an inner wall of a cell.
+bool distance_field::edge(const cell &c, int dir, uint32_t &v, uint32_t &u) const {
+    if (empty() || dir < 0 || dir > 3 || c.x % 2 == 0 || c.y % 2 == 0 || c.x >= unsigned(2 * rows_) ||
+        c.y >= unsigned(2 * cols_))
+        return false;
+    const int r = int(c.x / 2) + dir_row[dir], col = int(c.y / 2) + dir_col[dir];
+    if (r < 0 || r >= rows_ || col < 0 || col >= cols_)
+        return false;
+    v = id_of(c);
+    u = step(v, dir);
+    return true;
+}
+
+/*
+Opens a wall and lowers the distances it shortens.
+return False if the wall is not between two cells.
+ */
+bool distance_field::open(const cell &c, int dir) {
+    uint32_t v, u;
+    if (!edge(c, dir, v, u))
+        return false;
+    touched_ = 0;
+    if (open_[v] >> dir & 1)
+        return true;
+    open_[v] |= (unsigned char)(1u << dir);
+    open_[u] |= (unsigned char)(1u << (dir ^ 2));
+    if (dist_[v] > dist_[u])
+        std::swap(v, u);
+    if (dist_[v] == FAR || dist_[v] + 1 >= dist_[u])
+        return true; // Both unreachable, or no cell gets closer
+
+    // Breadth-first from the far side, stopping wherever distances are already as short
+    dist_[u] = dist_[v] + 1;
+    size_t tail = 0;
+    queue_[tail++] = u;
+    for (size_t head = 0; head < tail; ++head) {
+        const uint32_t x = queue_[head];
+        for (int d = 0; d < 4; ++d)
+            if (open_[x] >> d & 1) {
+                const uint32_t y = step(x, d);
+                if (dist_[x] + 1 < dist_[y]) {
+                    dist_[y] = dist_[x] + 1;
+                    queue_[tail++] = y;
+                }
+            }
+    }
+    touched_ = tail;
+    return true;
+}
+
+/*
+Closes a wall and raises the distances that depended on it.
+return False if the wall is not between two cells.
+ */
+bool distance_field::close(const cell &c, int dir) {
+    uint32_t v, u;
+    if (!edge(c, dir, v, u))
+        return false;
+    touched_ = 0;
+    if (!(open_[v] >> dir & 1))
+        return true;
+    open_[v] &= (unsigned char)~(1u << dir);
+    open_[u] &= (unsigned char)~(1u << (dir ^ 2));
+    if (dist_[v] > dist_[u])
+        std::swap(v, u);
+    if (dist_[v] == FAR || dist_[v] + 1 != dist_[u])
+        return true; // The passage was on no shortest route
+
+    // Find the lost cells: taken in order of distance, a cell is lost when no
+    // neighbor one step closer is still reached; only then are its children checked
+    lost_.clear();
+    size_t tail = 0;
+    queue_[tail++] = u;
+    mark_[u] = CHECKED;
+    for (size_t head = 0; head < tail; ++head) {
+        const uint32_t x = queue_[head];
+        bool supported = false;
+        for (int d = 0; d < 4 && !supported; ++d)
+            if (open_[x] >> d & 1) {
+                const uint32_t y = step(x, d);
+                supported = dist_[y] + 1 == dist_[x] && mark_[y] != LOST;
+            }
+        if (supported)
+            continue;
+        mark_[x] = LOST;
+        lost_.push_back(x);
+        for (int d = 0; d < 4; ++d)
+            if (open_[x] >> d & 1) {
+                const uint32_t y = step(x, d);
+                if (dist_[y] == dist_[x] + 1 && mark_[y] == UNSEEN) {
+                    mark_[y] = CHECKED;
+                    queue_[tail++] = y;
+                }
+            }
+    }
+
+    // Recompute the lost cells from the reached cells around them, nearest first
+    typedef std::pair<uint32_t, uint32_t> entry; // Distance, cell
+    std::priority_queue<entry, std::vector<entry>, std::greater<entry>> frontier;
+    for (uint32_t x : lost_) {
+        uint32_t best = FAR;
+        for (int d = 0; d < 4; ++d)
+            if (open_[x] >> d & 1) {
+                const uint32_t y = step(x, d);
+                if (mark_[y] != LOST && dist_[y] != FAR)
+                    best = std::min(best, dist_[y] + 1);
+            }
+        dist_[x] = best;
+        if (best != FAR)
+            frontier.push(entry(best, x));
+    }
+    while (!frontier.empty()) {
+        const entry top = frontier.top();
+        frontier.pop();
+        if (top.first != dist_[top.second])
+            continue;
+        const uint32_t x = top.second;
+        for (int d = 0; d < 4; ++d)
+            if (open_[x] >> d & 1) {
+                const uint32_t y = step(x, d);
+                if (mark_[y] == LOST && dist_[x] + 1 < dist_[y]) {
+                    dist_[y] = dist_[x] + 1;
+                    frontier.push(entry(dist_[y], y));
+                }
+            }
+    }
+
+    for (size_t i = 0; i < tail; ++i)
+        mark_[queue_[i]] = UNSEEN;
+    touched_ = tail;
+    return true;
+}
+
+size_t distance_field::distance(const cell &c) const {
+    if (empty() || c.x % 2 == 0 || c.y % 2 == 0 || c.x >= unsigned(2 * rows_) || c.y >= unsigned(2 * cols_))
+        return npos;
+    const uint32_t d = dist_[id_of(c)];
+    return d == FAR ? npos : size_t(d);
+}
+
+/*
+Walks from goal to the entrance, always to a neighbor one step closer.
+return The path from the entrance to goal; found is false if goal is unreachable.
+ */
+solve_result distance_field::path(const cell &goal) const {
+    solve_result res;
+    if (distance(goal) == npos)
+        return res;
+    const auto begin = std::chrono::steady_clock::now();
+    uint32_t v = id_of(goal);
+    res.path.reserve(size_t(dist_[v]) + 1);
+    res.path.push_back(goal);
+    while (dist_[v] > 0) {
+        for (int d = 0; d < 4; ++d) {
+            const uint32_t u = step(v, d);
+            if ((open_[v] >> d & 1) && dist_[u] + 1 == dist_[v]) {
+                v = u;
+                break;
+            }
+        }
+        res.path.push_back(cell_of(v));
+    }
+    std::reverse(res.path.begin(), res.path.end());
+    res.found = true;
+    res.stats.nodes_expanded = res.path.size();
+    res.stats.elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    return res;
+}
+
+template void distance_field::build<grid_view>(const grid_view &);
+template void distance_field::build<compact_walls>(const compact_walls &);
+template void distance_field::build<mapped_maze>(const mapped_maze &);
+
+}
@@ -0,0 +1,393 @@
+#include "maze.h"
+#include <cstring>
+
+namespace maze_gen {
+
+namespace {
+
+size_t pad8(size_t n) {
+    return (8 - n % 8) % 8;
+}
+
+// Bytes of one packed logical row: the words of a compact_walls row.
+size_t packed_row_bytes(int width) {
+    return (size_t((width - 1) / 2) * 2 + 63) / 64 * 8;
+}
+
+}
+
+/*
+Computes the CRC-32 (IEEE 802.3) of a buffer.
+param data Bytes to checksum.
+param size Number of bytes.
+param crc Running value from a previous call, or 0.
+return Updated checksum.
+ */
+uint32_t crc32(const void *data, size_t size, uint32_t crc) {
+    static const std::vector<uint32_t> table = [] {
+        std::vector<uint32_t> t(256);
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+
+    const unsigned char *p = static_cast<const unsigned char *>(data);
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i)
+        crc = table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+/*
+Run-length encodes a buffer (PackBits): a control byte n < 128 is followed by n + 1
+literal bytes; n > 128 repeats the next byte 257 - n times.
+param data Bytes to encode.
+param size Number of bytes.
+param out Receives the encoded bytes (cleared first).
+ */
+void rle_encode(const unsigned char *data, size_t size, std::vector<unsigned char> &out) {
+    out.clear();
+    size_t i = 0;
+    while (i < size) {
+        size_t run = 1;
+        while (i + run < size && run < 128 && data[i + run] == data[i])
+            ++run;
+        if (run >= 3) {
+            out.push_back((unsigned char)(257 - run));
+            out.push_back(data[i]);
+            i += run;
+            continue;
+        }
+        // Literal stretch up to the next run of three
+        size_t start = i, len = 0;
+        while (i < size && len < 128) {
+            if (i + 2 < size && data[i] == data[i + 1] && data[i] == data[i + 2])
+                break;
+            ++i;
+            ++len;
+        }
+        out.push_back((unsigned char)(len - 1));
+        out.insert(out.end(), data + start, data + start + len);
+    }
+}
+
+/*
+Decodes a PackBits buffer.
+param data Encoded bytes.
+param size Number of encoded bytes.
+param out Destination.
+param out_size Expected decoded size.
+return True if the input decodes to exactly out_size bytes.
+ */
+bool rle_decode(const unsigned char *data, size_t size, unsigned char *out, size_t out_size) {
+    size_t i = 0, o = 0;
+    while (i < size) {
+        unsigned n = data[i++];
+        if (n < 128) {
+            size_t len = n + 1;
+            if (i + len > size || o + len > out_size)
+                return false;
+            std::memcpy(out + o, data + i, len);
+            i += len;
+            o += len;
+        } else if (n > 128) {
+            size_t len = 257 - n;
+            if (i >= size || o + len > out_size)
+                return false;
+            std::memset(out + o, data[i++], len);
+            o += len;
+        }
+    }
+    return o == out_size;
+}
+
+/*
+Measures what is left of a stream without reading it.
+param in Stream to measure; its read position is kept.
+return Bytes from the read position to the end, or UINT64_MAX if the stream cannot seek.
+ */
+uint64_t stream_bytes_left(std::istream &in) {
+    const std::istream::pos_type here = in.tellg();
+    if (here == std::istream::pos_type(-1))
+        return UINT64_MAX;
+    in.seekg(0, std::ios::end);
+    const std::istream::pos_type end = in.tellg();
+    in.clear();
+    in.seekg(here);
+    if (end == std::istream::pos_type(-1) || end < here)
+        return UINT64_MAX;
+    return uint64_t(end - here);
+}
+
+/*
+Checks the passage bits of one packed row against what compact_walls can hold: a
+passage through the border would open the outer wall.
+param words The row, host order.
+param words_per_row Words in the row.
+param cols Logical cells in the row.
+param last_row True for the bottom logical row, whose cells have no south passage.
+return True if only interior passage bits are set.
+ */
+bool packed_row_valid(const uint64_t *words, size_t words_per_row, int cols, bool last_row) {
+    const size_t bits = 2 * size_t(cols), east = bits - 2; // East bit of the last column
+    for (size_t w = 0; w < words_per_row; ++w) {
+        const size_t first = 64 * w;
+        uint64_t allowed = bits <= first ? 0 : bits - first >= 64 ? ~uint64_t(0) : (uint64_t(1) << (bits - first)) - 1;
+        if (east >= first && east < first + 64)
+            allowed &= ~(uint64_t(1) << (east - first));
+        if (last_row)
+            allowed &= 0x5555555555555555ull; // East bits only
+        if (words[w] & ~allowed)
+            return false;
+    }
+    return true;
+}
+
+/*
+Checks that a grid only uses WALL and CELL, has walls on every corner and border
+position except the entrance (0,1) and exit (height-1,width-2), and open cells.
+param grid The grid to check.
+return True if compact_walls can hold the grid without loss.
+ */
+bool is_standard_layout(const grid2d<char> &grid) {
+    const int h = grid.rows(), w = grid.cols();
+    if (h < 3 || w < 3 || h % 2 == 0 || w % 2 == 0)
+        return false;
+    for (int x = 0; x < h; ++x) {
+        const char *row = grid.row(x);
+        for (int y = 0; y < w; ++y) {
+            char expected;
+            if (x == 0 || y == 0 || x == h - 1 || y == w - 1)
+                expected = (x == 0 && y == 1) || (x == h - 1 && y == w - 2) ? CELL : WALL;
+            else if (x % 2 == 0 && y % 2 == 0)
+                expected = WALL;
+            else if (x % 2 == 1 && y % 2 == 1)
+                expected = CELL;
+            else
+                expected = row[y] == WALL ? WALL : CELL; // Passage, either state
+            if (row[y] != expected)
+                return false;
+        }
+    }
+    return true;
+}
+
+maze_writer::maze_writer(std::ostream &out, const std::string &name, int height, int width, bool raw, bool compress,
+                         uint32_t rows_per_block)
+    : out_(out), raw_(raw), row_bytes_(raw ? size_t(width) : packed_row_bytes(width)), rows_per_block_(rows_per_block),
+      compress_(compress), rows_in_block_(0), bytes_written_(0) {
+    std::vector<unsigned char> header(FORMAT_HEADER_SIZE + name.size() + pad8(FORMAT_HEADER_SIZE + name.size()), 0);
+    std::memcpy(header.data(), FORMAT_MAGIC, 4);
+    put_u16(&header[4], FORMAT_VERSION);
+    put_u16(&header[6], (raw ? FLAG_RAW : 0) | (compress ? 0 : FLAG_STORED));
+    put_u32(&header[8], uint32_t(height));
+    put_u32(&header[12], uint32_t(width));
+    put_u32(&header[16], rows_per_block);
+    put_u32(&header[20], uint32_t(name.size()));
+    std::memcpy(&header[FORMAT_HEADER_SIZE], name.data(), name.size());
+    out_.write(reinterpret_cast<const char *>(header.data()), header.size());
+    bytes_written_ += header.size();
+    block_.reserve(row_bytes_ * rows_per_block_);
+}
+
+/*
+Appends one row to the current block, writing the block once it is full.
+param row Raw mode: width grid characters. Packed mode: one compact_walls row of 64-bit words.
+ */
+void maze_writer::write_row(const void *row) {
+    const size_t at = block_.size();
+    block_.resize(at + row_bytes_);
+    if (raw_) {
+        std::memcpy(&block_[at], row, row_bytes_);
+    } else {
+        // Words are stored little-endian whatever the host order
+        const uint64_t *words = static_cast<const uint64_t *>(row);
+        for (size_t w = 0; w < row_bytes_ / 8; ++w)
+            for (int b = 0; b < 8; ++b)
+                block_[at + 8 * w + b] = (words[w] >> (8 * b)) & 0xFF;
+    }
+    ++rows_in_block_;
+    if (rows_in_block_ == rows_per_block_)
+        flush_block();
+}
+
+// Writes the pending rows as one block.
+void maze_writer::flush_block() {
+    if (rows_in_block_ == 0)
+        return;
+    const uint32_t crc = crc32(block_.data(), block_.size());
+    const unsigned char *data = block_.data();
+    uint32_t stored = uint32_t(block_.size());
+    if (compress_) {
+        rle_encode(block_.data(), block_.size(), encoded_);
+        if (encoded_.size() < block_.size()) {
+            data = encoded_.data();
+            stored = uint32_t(encoded_.size()) | BLOCK_RLE;
+        }
+    }
+    const size_t size = stored & ~BLOCK_RLE;
+    unsigned char head[8];
+    put_u32(head, stored);
+    put_u32(head + 4, crc);
+    static const char zeros[8] = {0};
+    out_.write(reinterpret_cast<const char *>(head), 8);
+    out_.write(reinterpret_cast<const char *>(data), size);
+    out_.write(zeros, pad8(size));
+    bytes_written_ += 8 + size + pad8(size);
+
+    block_.clear();
+    rows_in_block_ = 0;
+}
+
+// Writes the last, partially filled block.
+void maze_writer::finish() {
+    flush_block();
+    out_.flush();
+}
+
+/*
+Reads and validates a version 2 header, leaving the stream at the first block.
+param in Stream positioned at the start of the file.
+param header Receives the header fields.
+param error Receives a message when the header is not valid.
+return True on success.
+ */
+bool read_header(std::istream &in, maze_header &header, std::string &error) {
+    unsigned char fixed[FORMAT_HEADER_SIZE];
+    if (!in.read(reinterpret_cast<char *>(fixed), FORMAT_HEADER_SIZE) || std::memcmp(fixed, FORMAT_MAGIC, 4) != 0) {
+        error = "not a version 2 maze file";
+        return false;
+    }
+    header.version = get_u16(fixed + 4);
+    header.flags = get_u16(fixed + 6);
+    header.height = get_u32(fixed + 8);
+    header.width = get_u32(fixed + 12);
+    header.rows_per_block = get_u32(fixed + 16);
+    const uint32_t name_length = get_u32(fixed + 20);
+
+    if (header.version != FORMAT_VERSION) {
+        error = "unsupported format version " + std::to_string(header.version);
+        return false;
+    }
+    if (header.height < 3 || header.width < 3 || header.height % 2 == 0 || header.width % 2 == 0 ||
+        header.height > 0x7FFFFFFF || header.width > 0x7FFFFFFF || header.rows_per_block == 0 ||
+        name_length > (1u << 20)) {
+        error = "corrupt header";
+        return false;
+    }
+
+    header.name.resize(name_length);
+    char pad[8];
+    if (!in.read(&header.name[0], name_length) || !in.read(pad, pad8(FORMAT_HEADER_SIZE + name_length))) {
+        error = "truncated header";
+        return false;
+    }
+    header.payload_offset = FORMAT_HEADER_SIZE + name_length + pad8(FORMAT_HEADER_SIZE + name_length);
+    return true;
+}
+
+/*
+Reads and verifies every block of a version 2 file.
+param in Stream positioned after the header.
+param header Header returned by read_header.
+param walls Filled for packed files.
+param grid Filled for raw files.
+param error Receives a message on failure.
+param bytes_read Optional counter of payload bytes consumed.
+return True on success.
+ */
+bool read_payload(std::istream &in, const maze_header &header, compact_walls &walls, grid2d<char> &grid,
+                  std::string &error, uint64_t *bytes_read) {
+    const bool raw = header.flags & FLAG_RAW;
+    const int height = int(header.height), width = int(header.width);
+    const size_t row_bytes = raw ? size_t(width) : packed_row_bytes(width);
+    const int total_rows = raw ? height : (height - 1) / 2;
+
+    // Stored blocks hold every payload byte; run-length encoding shrinks one at most 64-fold
+    const uint64_t total = uint64_t(row_bytes) * uint64_t(total_rows);
+    const uint64_t blocks = (uint64_t(total_rows) + header.rows_per_block - 1) / header.rows_per_block;
+    const uint64_t least = blocks * 8 + ((header.flags & FLAG_STORED) ? total : total / 64);
+    if (total > MAX_PAYLOAD_BYTES || least > stream_bytes_left(in)) {
+        error = "corrupt header";
+        return false;
+    }
+
+    if (raw) {
+        walls.clear();
+        grid.assign(height, width);
+    } else {
+        grid.clear();
+        walls.assign(height, width);
+        if (walls.plane().words_per_row() * 8 != row_bytes) {
+            error = "corrupt header";
+            return false;
+        }
+    }
+
+    std::vector<unsigned char> stored, decoded;
+    for (int first = 0; first < total_rows; first += header.rows_per_block) {
+        const int rows = std::min<int>(header.rows_per_block, total_rows - first);
+        const size_t expected = row_bytes * rows;
+
+        unsigned char head[8];
+        if (!in.read(reinterpret_cast<char *>(head), 8)) {
+            error = "truncated file";
+            return false;
+        }
+        const uint32_t size_field = get_u32(head), crc = get_u32(head + 4);
+        const bool rle = size_field & BLOCK_RLE;
+        const size_t size = size_field & ~BLOCK_RLE;
+        if ((!rle && size != expected) || (rle && size > expected + expected / 64 + 16)) {
+            error = "corrupt block size";
+            return false;
+        }
+
+        stored.resize(size + pad8(size));
+        if (!in.read(reinterpret_cast<char *>(stored.data()), stored.size())) {
+            error = "truncated file";
+            return false;
+        }
+        if (bytes_read)
+            *bytes_read += 8 + stored.size();
+
+        const unsigned char *data = stored.data();
+        if (rle) {
+            decoded.resize(expected);
+            if (!rle_decode(stored.data(), size, decoded.data(), expected)) {
+                error = "corrupt compressed block";
+                return false;
+            }
+            data = decoded.data();
+        }
+        if (crc32(data, expected) != crc) {
+            error = "checksum mismatch in rows " + std::to_string(first) + "-" + std::to_string(first + rows - 1);
+            return false;
+        }
+
+        for (int i = 0; i < rows; ++i) {
+            const unsigned char *src = data + row_bytes * i;
+            if (raw) {
+                std::memcpy(grid.row(first + i), src, row_bytes);
+            } else {
+                uint64_t *dst = walls.plane().row_words(first + i);
+                for (size_t w = 0; w < row_bytes / 8; ++w) {
+                    uint64_t v = 0;
+                    for (int b = 7; b >= 0; --b)
+                        v = (v << 8) | src[8 * w + b];
+                    dst[w] = v;
+                }
+                if (!packed_row_valid(dst, row_bytes / 8, (width - 1) / 2, first + i == total_rows - 1)) {
+                    error = "corrupt passages in row " + std::to_string(first + i);
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+}
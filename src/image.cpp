@@ -0,0 +1,387 @@
+#include "maze.h"
+#include <cstring>
+#include <thread>
+
+namespace maze_gen {
+
+// Returns the command-line name of an image format.
+const char *image_format_name(image_format format) {
+    switch (format) {
+    case image_format::pbm: return "pbm";
+    case image_format::pgm: return "pgm";
+    case image_format::png: return "png";
+    }
+    return "unknown";
+}
+
+/*
+Looks up an image format by its name.
+param name One of pbm, pgm, png.
+param format Set to the matching format.
+return True if the name is known.
+ */
+bool parse_image_format(const std::string &name, image_format &format) {
+    for (image_format f : {image_format::pbm, image_format::pgm, image_format::png})
+        if (name == image_format_name(f)) {
+            format = f;
+            return true;
+        }
+    return false;
+}
+
+namespace {
+
+const size_t STORED_BLOCK = 65535; // Largest stored deflate block
+const uint32_t ADLER_MOD = 65521;
+
+void put_u32be(unsigned char *p, uint32_t v) {
+    p[0] = (unsigned char)(v >> 24);
+    p[1] = (unsigned char)(v >> 16);
+    p[2] = (unsigned char)(v >> 8);
+    p[3] = (unsigned char)v;
+}
+
+// Bytes of one scanline of width pixels, including the filter byte of PNG.
+size_t line_bytes(image_format format, int width) {
+    switch (format) {
+    case image_format::pbm: return (size_t(width) + 7) / 8;
+    case image_format::pgm: return size_t(width);
+    case image_format::png: return 1 + (size_t(width) * 2 + 7) / 8;
+    }
+    return 0;
+}
+
+// Palette index of each grid position character: 0 wall, 1 passage, 2 path.
+struct shade_table {
+    unsigned char index[256];
+
+    shade_table() {
+        std::memset(index, 1, sizeof index);
+        index[(unsigned char)WALL] = 0;
+        index[(unsigned char)PATH] = 2;
+    }
+    unsigned operator()(char c) const { return index[(unsigned char)c]; }
+};
+
+const shade_table shade;
+
+/*
+Packs n grid positions into one scanline, scale pixels each.
+param row WALL/CELL/PATH characters.
+param out line_bytes() of the format for n * scale pixels.
+ */
+void pack_line(image_format format, const char *row, int n, int scale, unsigned char *out) {
+    static const unsigned char grey[3] = {0, 255, 128};
+    if (format == image_format::png)
+        *out++ = 0; // Filter type none
+    if (scale == 1) {
+        // One pixel per position: whole output bytes at a time, the rest below
+        int j = 0;
+        if (format == image_format::pgm) {
+            for (; j < n; ++j)
+                out[j] = grey[shade(row[j])];
+            return;
+        } else if (format == image_format::pbm) {
+            for (; j + 8 <= n; j += 8) {
+                unsigned b = 0;
+                for (int k = 0; k < 8; ++k)
+                    b = b << 1 | unsigned(row[j + k] == WALL);
+                *out++ = (unsigned char)b;
+            }
+        } else {
+            for (; j + 4 <= n; j += 4)
+                *out++ = (unsigned char)(shade(row[j]) << 6 | shade(row[j + 1]) << 4 | shade(row[j + 2]) << 2 |
+                                         shade(row[j + 3]));
+        }
+        row += j;
+        n -= j;
+    }
+    if (format == image_format::pgm) {
+        for (int j = 0; j < n; ++j, out += scale)
+            std::memset(out, grey[shade(row[j])], size_t(scale));
+        return;
+    }
+    const unsigned bits = format == image_format::pbm ? 1 : 2;
+    unsigned acc = 0, filled = 0;
+    for (int j = 0; j < n; ++j) {
+        const unsigned v = bits == 1 ? unsigned(row[j] == WALL) : shade(row[j]);
+        for (int s = 0; s < scale; ++s) {
+            acc = acc << bits | v;
+            filled += bits;
+            if (filled == 8) {
+                *out++ = (unsigned char)acc;
+                acc = filled = 0;
+            }
+        }
+    }
+    if (filled)
+        *out = (unsigned char)(acc << (8 - filled));
+}
+
+// Grid row x of a maze view, columns [y0, y0 + n), as WALL/CELL characters.
+template <typename View>
+void read_row(const View &maze, int x, int y0, int n, char *out) {
+    for (int j = 0; j < n; ++j)
+        out[j] = maze.is_wall(x, y0 + j) ? WALL : CELL;
+}
+
+// Whole rows of compact storage are expanded from their passage words.
+void read_row(const compact_walls &maze, int x, int y0, int n, char *out) {
+    if (y0 == 0 && n == maze.width()) {
+        maze.expand_row(x, out);
+        return;
+    }
+    for (int j = 0; j < n; ++j)
+        out[j] = maze.is_wall(x, y0 + j) ? WALL : CELL;
+}
+
+// Byte grids hold the characters already.
+void read_row(const grid_view &maze, int x, int y0, int n, char *out) {
+    std::memcpy(out, maze.row(x) + y0, size_t(n));
+}
+
+// Marks the positions of grid row x, columns [y0, y0 + n), that a path overlay uses with PATH.
+void mark_path(const compact_walls &overlay, int x, int y0, int n, char *out) {
+    if (y0 == 0 && n == overlay.width()) {
+        mark_path_row(overlay, x, out);
+        return;
+    }
+    if (x <= 0 || x >= overlay.height() - 1)
+        return;
+    const int end = std::min(y0 + n, overlay.width() - 1);
+    for (int y = std::max(y0, 1); y < end; ++y) {
+        bool on = false;
+        if (x % 2 == 1 && y % 2 == 1) {
+            const int r = x / 2, c = y / 2;
+            on = overlay.get(r, c) || (c > 0 && (overlay.get(r, c - 1) & compact_walls::east)) ||
+                 (r > 0 && (overlay.get(r - 1, c) & compact_walls::south));
+        } else if (x % 2 == 1) {
+            on = overlay.get(x / 2, y / 2 - 1) & compact_walls::east;
+        } else if (y % 2 == 1) {
+            on = overlay.get(x / 2 - 1, y / 2) & compact_walls::south;
+        }
+        if (on)
+            out[y - y0] = PATH;
+    }
+}
+
+// Clips the region of opts to a height x width maze; false if nothing of it is left.
+bool clip_region(image_options &opts, int height, int width) {
+    opts.top = std::max(0, opts.top);
+    opts.left = std::max(0, opts.left);
+    const int rows = height - opts.top, cols = width - opts.left;
+    opts.rows = opts.rows > 0 ? std::min(opts.rows, rows) : rows;
+    opts.cols = opts.cols > 0 ? std::min(opts.cols, cols) : cols;
+    opts.scale = std::max(1, opts.scale);
+    return opts.rows > 0 && opts.cols > 0;
+}
+
+}
+
+/*
+ Writes the header, then whole scanlines as they come, then the trailer. PNG data
+ goes into a zlib stream of stored blocks, one IDAT chunk per write, with the
+ Adler-32 of the stream kept running until finish().
+ */
+class image_encoder {
+  private:
+    std::ostream &out_;
+    image_format format_;
+    uint32_t adler_a_, adler_b_;
+    uint32_t crc_;
+    bool started_; // zlib header written
+
+    void begin_chunk(const char *type, uint32_t length) {
+        unsigned char head[8];
+        put_u32be(head, length);
+        std::memcpy(head + 4, type, 4);
+        out_.write(reinterpret_cast<const char *>(head), 8);
+        crc_ = crc32(type, 4);
+    }
+    void chunk_data(const void *data, size_t size) {
+        out_.write(static_cast<const char *>(data), std::streamsize(size));
+        crc_ = crc32(data, size, crc_);
+    }
+    void end_chunk() {
+        unsigned char tail[4];
+        put_u32be(tail, crc_);
+        out_.write(reinterpret_cast<const char *>(tail), 4);
+    }
+    void zlib_header() {
+        static const unsigned char header[2] = {0x78, 0x01}; // Deflate, 32K window, no dictionary
+        if (!started_)
+            chunk_data(header, 2);
+        started_ = true;
+    }
+    void adler(const unsigned char *p, size_t size) {
+        while (size > 0) {
+            size_t k = std::min<size_t>(size, 5552); // Most bytes before b can overflow
+            size -= k;
+            while (k--) {
+                adler_a_ += *p++;
+                adler_b_ += adler_a_;
+            }
+            adler_a_ %= ADLER_MOD;
+            adler_b_ %= ADLER_MOD;
+        }
+    }
+
+  public:
+    image_encoder(std::ostream &out, image_format format, int width, int height)
+        : out_(out), format_(format), adler_a_(1), adler_b_(0), crc_(0), started_(false) {
+        if (format == image_format::pbm) {
+            out_ << "P4\n" << width << ' ' << height << '\n';
+        } else if (format == image_format::pgm) {
+            out_ << "P5\n" << width << ' ' << height << "\n255\n";
+        } else {
+            static const unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+            out_.write(reinterpret_cast<const char *>(signature), 8);
+            unsigned char ihdr[13] = {0};
+            put_u32be(ihdr, uint32_t(width));
+            put_u32be(ihdr + 4, uint32_t(height));
+            ihdr[8] = 2; // Bit depth
+            ihdr[9] = 3; // Palette colour
+            begin_chunk("IHDR", 13);
+            chunk_data(ihdr, 13);
+            end_chunk();
+            static const unsigned char palette[9] = {0, 0, 0, 255, 255, 255, 208, 32, 32};
+            begin_chunk("PLTE", 9);
+            chunk_data(palette, 9);
+            end_chunk();
+        }
+    }
+
+    void write(const unsigned char *data, size_t size) {
+        if (format_ != image_format::png) {
+            out_.write(reinterpret_cast<const char *>(data), std::streamsize(size));
+            return;
+        }
+        if (size == 0)
+            return;
+        const size_t blocks = (size + STORED_BLOCK - 1) / STORED_BLOCK;
+        begin_chunk("IDAT", uint32_t((started_ ? 0 : 2) + blocks * 5 + size));
+        zlib_header();
+        adler(data, size);
+        for (size_t done = 0; done < size; done += STORED_BLOCK) {
+            const unsigned n = unsigned(std::min(STORED_BLOCK, size - done));
+            const unsigned char head[5] = {0, (unsigned char)n, (unsigned char)(n >> 8), (unsigned char)~n,
+                                           (unsigned char)(~n >> 8)};
+            chunk_data(head, 5);
+            chunk_data(data + done, n);
+        }
+        end_chunk();
+    }
+
+    void finish() {
+        if (format_ == image_format::png) {
+            // An empty final block closes the deflate stream
+            unsigned char tail[9] = {1, 0, 0, 0xFF, 0xFF};
+            put_u32be(tail + 5, adler_b_ << 16 | adler_a_);
+            begin_chunk("IDAT", started_ ? 9 : 11);
+            zlib_header();
+            chunk_data(tail, 9);
+            end_chunk();
+            begin_chunk("IEND", 0);
+            end_chunk();
+        }
+        out_.flush();
+    }
+};
+
+template <typename View>
+bool write_image(std::ostream &out, const View &maze, const compact_walls *path, const image_options &options) {
+    image_options opts = options;
+    if (!clip_region(opts, maze.height(), maze.width()))
+        return false;
+    MAZE_PROFILE_SCOPE(print);
+    const int scale = opts.scale;
+    const int threads = opts.threads > 0 ? opts.threads : int(std::max(1u, std::thread::hardware_concurrency()));
+    const int band_rows = std::max(1, opts.band_rows);
+    const size_t line = line_bytes(opts.format, opts.cols * scale);
+
+    // Band slots are reused from round to round, so memory does not grow with the maze
+    std::vector<std::vector<unsigned char>> pixels(threads);
+    std::vector<std::vector<char>> rows(threads, std::vector<char>(size_t(opts.cols)));
+    auto render = [&](int slot, int first, int end) {
+        std::vector<unsigned char> &band = pixels[slot];
+        char *row = rows[slot].data();
+        band.resize(size_t(end - first) * scale * line);
+        unsigned char *p = band.data();
+        for (int x = opts.top + first; x < opts.top + end; ++x) {
+            read_row(maze, x, opts.left, opts.cols, row);
+            if (path)
+                mark_path(*path, x, opts.left, opts.cols, row);
+            pack_line(opts.format, row, opts.cols, scale, p);
+            for (int s = 1; s < scale; ++s)
+                std::memcpy(p + s * line, p, line);
+            p += scale * line;
+        }
+    };
+
+    image_encoder encoder(out, opts.format, opts.cols * scale, opts.rows * scale);
+    for (int first = 0; first < opts.rows; first += threads * band_rows) {
+        const int bands = std::min(threads, (opts.rows - first + band_rows - 1) / band_rows);
+        std::vector<std::thread> pool;
+        for (int b = 1; b < bands; ++b)
+            pool.emplace_back(render, b, first + b * band_rows, std::min(opts.rows, first + (b + 1) * band_rows));
+        render(0, first, std::min(opts.rows, first + band_rows));
+        for (std::thread &th : pool)
+            th.join();
+        for (int b = 0; b < bands; ++b)
+            encoder.write(pixels[b].data(), pixels[b].size());
+    }
+    encoder.finish();
+    return bool(out);
+}
+
+image_sink::image_sink(std::ostream &out, const image_options &opts) : out_(out), opts_(opts), x_(0) {}
+
+image_sink::~image_sink() = default;
+
+// Writes the header; rows outside the region are skipped as they arrive.
+void image_sink::begin(int height, int width) {
+    x_ = 0;
+    encoder_.reset();
+    if (!clip_region(opts_, height, width))
+        return;
+    encoder_.reset(new image_encoder(out_, opts_.format, opts_.cols * opts_.scale, opts_.rows * opts_.scale));
+    opts_.band_rows = std::max(1, opts_.band_rows);
+    line_.clear();
+    line_.reserve(size_t(opts_.band_rows) * opts_.scale * line_bytes(opts_.format, opts_.cols * opts_.scale));
+}
+
+void image_sink::row(const char *row, int) {
+    const int x = x_++;
+    if (!encoder_ || x < opts_.top || x >= opts_.top + opts_.rows)
+        return;
+    const size_t line = line_bytes(opts_.format, opts_.cols * opts_.scale);
+    const size_t at = line_.size();
+    line_.resize(at + opts_.scale * line);
+    pack_line(opts_.format, row + opts_.left, opts_.cols, opts_.scale, &line_[at]);
+    for (int s = 1; s < opts_.scale; ++s)
+        std::memcpy(&line_[at + s * line], &line_[at], line);
+    if (line_.size() >= size_t(opts_.band_rows) * opts_.scale * line) {
+        encoder_->write(line_.data(), line_.size());
+        line_.clear();
+    }
+}
+
+void image_sink::end() {
+    if (!encoder_)
+        return;
+    encoder_->write(line_.data(), line_.size());
+    line_.clear();
+    encoder_->finish();
+}
+
+bool image_sink::ok() const {
+    return encoder_ && out_;
+}
+
+template bool write_image<grid_view>(std::ostream &, const grid_view &, const compact_walls *, const image_options &);
+template bool write_image<compact_walls>(std::ostream &, const compact_walls &, const compact_walls *,
+                                         const image_options &);
+template bool write_image<mapped_maze>(std::ostream &, const mapped_maze &, const compact_walls *,
+                                       const image_options &);
+
+}
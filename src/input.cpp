@@ -0,0 +1,53 @@
+#include "maze.h"
+
+namespace maze_gen {
+
+/*
+Decodes the next key from the buffered input.
+param key Set to the decoded key; play_key::none for bytes that mean nothing to the game.
+return False when the buffer is empty or holds only the start of an escape sequence.
+ */
+bool key_decoder::next(play_key &key) {
+    if (pending_.empty())
+        return false;
+
+    const char c = pending_[0];
+    if (c == '\033') {
+        if (pending_.size() == 1)
+            return false;
+        key = play_key::none;
+        if (pending_[1] != '[' && pending_[1] != 'O') {
+            pending_.erase(0, 1); // Not a sequence; drop the ESC alone
+            return true;
+        }
+        // Skip parameter bytes (modifiers such as ESC [ 1 ; 2 A) up to the final byte
+        size_t end = 2;
+        if (pending_[1] == '[')
+            while (end < pending_.size() && pending_[end] >= 0x30 && pending_[end] <= 0x3F)
+                ++end;
+        if (end >= pending_.size())
+            return false;
+        switch (pending_[end]) {
+        case 'A': key = play_key::up; break;
+        case 'B': key = play_key::down; break;
+        case 'C': key = play_key::right; break;
+        case 'D': key = play_key::left; break;
+        default: break;
+        }
+        pending_.erase(0, end + 1);
+        return true;
+    }
+
+    pending_.erase(0, 1);
+    switch (c) {
+    case 'w': case 'W': key = play_key::up; break;
+    case 's': case 'S': key = play_key::down; break;
+    case 'a': case 'A': key = play_key::left; break;
+    case 'd': case 'D': key = play_key::right; break;
+    case 'q': case 'Q': key = play_key::quit; break;
+    default: key = play_key::none; break;
+    }
+    return true;
+}
+
+}
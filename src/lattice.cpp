@@ -0,0 +1,372 @@
+#include "maze.h"
+#include <chrono>
+#include <cstring>
+
+namespace maze_gen {
+
+namespace {
+
+const uint8_t ROOT = 0xFF; // Parent mark of the first cell
+
+}
+
+/*
+Sizes the lattice and closes every passage.
+param dims Cells along each axis, axis 0 first.
+return False, leaving the lattice empty, if a size is below 1 or there are 2^32 cells or more.
+ */
+template <int N>
+bool lattice<N>::assign(const point &dims) {
+    uint64_t n = 1;
+    for (int a = N - 1; a >= 0; --a) {
+        if (dims[a] < 1 || n * uint64_t(dims[a]) > 0xFFFFFFFFull) {
+            clear();
+            return false;
+        }
+        stride_[a] = size_t(n);
+        n *= uint64_t(dims[a]);
+    }
+    dims_ = dims;
+    links_.assign(size_t(n), 0);
+    return true;
+}
+
+/*
+Depth-first backtracking from the first cell. Each visited cell records the
+direction back to its parent (direction k is axis k / 2, forward when k is odd)
+in one byte, which replaces the stack, and the walk keeps its coordinates so no
+cell index is ever divided.
+param seed Seed of the maze; drawn through mix_seed like the 2D generator's.
+ */
+template <int N>
+void lattice<N>::generate(uint64_t seed) {
+    std::fill(links_.begin(), links_.end(), 0);
+    if (links_.empty())
+        return;
+    maze_rng rng(mix_seed(seed, 0));
+    std::vector<uint8_t> parent(links_.size(), 0);
+    point at = point();
+    size_t v = 0;
+    parent[0] = ROOT;
+    size_t visited = 1;
+    MAZE_PROFILE_SCOPE(carve);
+    for (;;) {
+        int options[2 * N];
+        int count = 0;
+        for (int a = 0; a < N; ++a) {
+            if (at[a] > 0 && !parent[v - stride_[a]])
+                options[count++] = 2 * a;
+            if (at[a] + 1 < dims_[a] && !parent[v + stride_[a]])
+                options[count++] = 2 * a + 1;
+        }
+        int k;
+        if (count > 0) {
+            k = options[rng.bounded(uint64_t(count))];
+            if (k & 1)
+                carve(v, k >> 1);
+            else
+                carve(v - stride_[k >> 1], k >> 1);
+            ++visited;
+        } else if (parent[v] == ROOT) {
+            break;
+        } else {
+            k = parent[v] - 1; // Back to the parent
+            MAZE_PROFILE_COUNT(backtracks, 1);
+        }
+        const int a = k >> 1;
+        if (k & 1) {
+            v += stride_[a];
+            ++at[a];
+        } else {
+            v -= stride_[a];
+            --at[a];
+        }
+        if (count > 0)
+            parent[v] = uint8_t(1 + (k ^ 1));
+    }
+    MAZE_PROFILE_COUNT(cells_visited, visited);
+}
+
+/*
+Finds the path from the first cell to the last breadth-first, recording in one
+byte per cell the direction each cell was reached from.
+return The path; found is false if the last cell cannot be reached.
+ */
+template <int N>
+lattice_path lattice<N>::solve() const {
+    lattice_path res;
+    if (links_.empty())
+        return res;
+    MAZE_PROFILE_SCOPE(solve);
+    const auto begin = std::chrono::steady_clock::now();
+    const size_t n = links_.size(), goal = n - 1;
+    std::vector<uint8_t> from(n, 0);
+    std::vector<uint32_t> queue(n);
+    size_t head = 0, tail = 0;
+    from[0] = ROOT;
+    queue[tail++] = 0;
+    while (head < tail && !from[goal]) {
+        const size_t v = queue[head++];
+        const point p = coords(v);
+        for (int a = 0; a < N; ++a) {
+            if (passage(v, p, a, true) && !from[v + stride_[a]]) {
+                from[v + stride_[a]] = uint8_t(1 + 2 * a); // Reached going forward
+                queue[tail++] = uint32_t(v + stride_[a]);
+            }
+            if (passage(v, p, a, false) && !from[v - stride_[a]]) {
+                from[v - stride_[a]] = uint8_t(2 + 2 * a);
+                queue[tail++] = uint32_t(v - stride_[a]);
+            }
+        }
+    }
+    res.stats.nodes_expanded = head;
+    MAZE_PROFILE_COUNT(nodes_expanded, head);
+    if (from[goal]) {
+        for (size_t v = goal;; ) {
+            res.cells.push_back(v);
+            if (from[v] == ROOT)
+                break;
+            const int a = (from[v] - 1) >> 1;
+            v = (from[v] - 1) & 1 ? v + stride_[a] : v - stride_[a];
+        }
+        std::reverse(res.cells.begin(), res.cells.end());
+        res.found = true;
+    }
+    res.stats.elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    return res;
+}
+
+/*
+Writes the lattice in the format described in lattice.h.
+return True if the file was written.
+ */
+template <int N>
+bool lattice<N>::save(const std::string &filename, std::string &error) const {
+    std::ofstream file(filename, std::ios::binary);
+    if (!file) {
+        error = "cannot open " + filename;
+        return false;
+    }
+    MAZE_PROFILE_SCOPE(save);
+    unsigned char header[8 + 4 * N];
+    std::memcpy(header, LATTICE_MAGIC, 4);
+    put_u16(header + 4, LATTICE_VERSION);
+    put_u16(header + 6, uint16_t(N));
+    for (int a = 0; a < N; ++a)
+        put_u32(header + 8 + 4 * a, uint32_t(dims_[a]));
+    file.write(reinterpret_cast<const char *>(header), sizeof(header));
+
+    // N bits per cell through a 64-bit accumulator, written a buffer at a time
+    unsigned char buffer[4096];
+    size_t used = 0;
+    uint64_t bits = 0;
+    int pending = 0;
+    uint32_t crc = 0;
+    auto emit = [&](unsigned char byte) {
+        buffer[used++] = byte;
+        if (used == sizeof(buffer)) {
+            crc = crc32(buffer, used, crc);
+            file.write(reinterpret_cast<const char *>(buffer), std::streamsize(used));
+            used = 0;
+        }
+    };
+    for (uint8_t cell_links : links_) {
+        bits |= uint64_t(cell_links) << pending;
+        pending += N;
+        for (; pending >= 8; pending -= 8, bits >>= 8)
+            emit((unsigned char)(bits & 0xFF));
+    }
+    if (pending > 0)
+        emit((unsigned char)(bits & 0xFF));
+    crc = crc32(buffer, used, crc);
+    file.write(reinterpret_cast<const char *>(buffer), std::streamsize(used));
+    unsigned char tail[4];
+    put_u32(tail, crc);
+    file.write(reinterpret_cast<const char *>(tail), 4);
+    MAZE_PROFILE_COUNT(bytes_written, sizeof(header) + (links_.size() * N + 7) / 8 + 4);
+    if (!file) {
+        error = "error writing " + filename;
+        return false;
+    }
+    return true;
+}
+
+/*
+Reads a lattice written by save() with the same number of dimensions.
+param error Receives a message if the file is unusable.
+return True if the file was complete and intact.
+ */
+template <int N>
+bool lattice<N>::load(const std::string &filename, std::string &error) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file) {
+        error = "cannot open " + filename;
+        return false;
+    }
+    MAZE_PROFILE_SCOPE(load);
+    unsigned char header[8 + 4 * N];
+    if (!file.read(reinterpret_cast<char *>(header), 8) || std::memcmp(header, LATTICE_MAGIC, 4) != 0) {
+        error = "not a lattice maze file";
+        return false;
+    }
+    if (get_u16(header + 4) != LATTICE_VERSION) {
+        error = "unsupported lattice maze version " + std::to_string(get_u16(header + 4));
+        return false;
+    }
+    if (get_u16(header + 6) != N) {
+        error = "maze has " + std::to_string(get_u16(header + 6)) + " dimensions, expected " + std::to_string(N);
+        return false;
+    }
+    point dims;
+    if (!file.read(reinterpret_cast<char *>(header + 8), 4 * N)) {
+        error = "lattice maze header is truncated";
+        return false;
+    }
+    // The cells the header claims have to be in the file before they are allocated
+    uint64_t cells = 1;
+    for (int a = 0; a < N; ++a) {
+        dims[a] = int(std::min<uint32_t>(get_u32(header + 8 + 4 * a), 0x7FFFFFFF));
+        cells = std::min<uint64_t>(cells * uint64_t(dims[a]), uint64_t(1) << 32);
+    }
+    if (cells > 0 && (cells * N + 7) / 8 + 4 > stream_bytes_left(file)) {
+        error = "lattice maze is truncated";
+        return false;
+    }
+    if (!assign(dims)) {
+        error = "lattice maze header is invalid";
+        return false;
+    }
+
+    unsigned char buffer[4096];
+    uint64_t bits = 0;
+    int pending = 0;
+    uint32_t crc = 0;
+    size_t left = (links_.size() * N + 7) / 8, used = 0, filled = 0;
+    for (uint8_t &cell_links : links_) {
+        while (pending < N) {
+            if (used == filled) {
+                filled = std::min(left, sizeof(buffer));
+                if (!file.read(reinterpret_cast<char *>(buffer), std::streamsize(filled))) {
+                    error = "lattice maze is truncated";
+                    clear();
+                    return false;
+                }
+                crc = crc32(buffer, filled, crc);
+                left -= filled;
+                used = 0;
+            }
+            bits |= uint64_t(buffer[used++]) << pending;
+            pending += 8;
+        }
+        cell_links = uint8_t(bits & ((1u << N) - 1));
+        bits >>= N;
+        pending -= N;
+    }
+    unsigned char tail[4];
+    if (!file.read(reinterpret_cast<char *>(tail), 4) || get_u32(tail) != crc) {
+        error = "lattice maze checksum mismatch";
+        clear();
+        return false;
+    }
+    // Passages off the far side of an axis would lead outside the lattice
+    point p = point();
+    for (size_t i = 0; i < links_.size(); ++i) {
+        for (int a = 0; a < N; ++a)
+            if ((links_[i] >> a & 1) && p[a] + 1 == dims_[a]) {
+                error = "lattice maze is corrupt";
+                clear();
+                return false;
+            }
+        for (int a = N - 1; a >= 0 && ++p[a] == dims_[a]; --a) // Next cell, last axis fastest
+            p[a] = 0;
+    }
+    MAZE_PROFILE_COUNT(bytes_read, sizeof(header) + (links_.size() * N + 7) / 8 + 4);
+    return true;
+}
+
+/*
+Prints each floor of a layered maze in the text form of print_maze.
+param path Solution to mark, or null.
+ */
+void write_text(std::ostream &out, const lattice<3> &maze, const lattice_path *path) {
+    if (maze.empty())
+        return;
+    const int floors = maze.dims()[0], rows = maze.dims()[1], cols = maze.dims()[2];
+    const int height = 2 * rows + 1, width = 2 * cols + 1;
+
+    // Steps of the path as passages of an overlay lattice, like trace_path for 2D mazes
+    lattice<3> trail;
+    if (path) {
+        trail.assign(maze.dims());
+        for (size_t i = 1; i < path->cells.size(); ++i) {
+            const size_t a = std::min(path->cells[i - 1], path->cells[i]), b = std::max(path->cells[i - 1], path->cells[i]);
+            trail.carve(a, b - a == maze.stride(0) ? 0 : b - a == maze.stride(1) ? 1 : 2);
+        }
+    }
+    auto on_trail = [&](size_t v, const lattice<3>::point &p) {
+        if (trail.empty())
+            return false;
+        for (int a = 0; a < 3; ++a)
+            if (trail.passage(v, p, a, true) || trail.passage(v, p, a, false))
+                return true;
+        return false;
+    };
+
+    std::vector<char> row(width);
+    std::vector<char> line(simd::text_row_capacity(width) + 1);
+    for (int z = 0; z < floors; ++z) {
+        out << "Floor " << z + 1 << " of " << floors << "\n";
+        for (int x = 0; x < height; ++x) {
+            std::fill(row.begin(), row.end(), WALL);
+            if (x == 0 && z == 0)
+                row[1] = CELL; // Entrance
+            if (x == height - 1 && z == floors - 1)
+                row[width - 2] = CELL; // Exit
+            if (x > 0 && x < height - 1) {
+                const int r = x / 2 - (x % 2 == 0);
+                for (int c = 0; c < cols; ++c) {
+                    const lattice<3>::point p = {z, r, c};
+                    const size_t v = maze.id(p);
+                    if (x % 2 == 1) {
+                        const bool up = maze.passage(v, p, 0, true), down = maze.passage(v, p, 0, false);
+                        row[2 * c + 1] = up && down ? STAIR_BOTH : up ? STAIR_UP : down ? STAIR_DOWN
+                                       : on_trail(v, p) ? PATH : CELL;
+                        if (maze.passage(v, p, 2, true))
+                            row[2 * c + 2] = !trail.empty() && trail.passage(v, p, 2, true) ? PATH : CELL;
+                    } else if (maze.passage(v, p, 1, true)) {
+                        row[2 * c + 1] = !trail.empty() && trail.passage(v, p, 1, true) ? PATH : CELL;
+                    }
+                }
+            }
+            size_t n = simd::expand_text_row(row.data(), width, line.data(), false);
+            line[n++] = '\n';
+            out.write(line.data(), std::streamsize(n));
+        }
+    }
+    out << std::flush;
+}
+
+/*
+Copies a 2D lattice into compact storage, where the 2D tools (printing, saving,
+solving, the path index) can use it.
+ */
+compact_walls to_compact(const lattice<2> &maze) {
+    compact_walls walls;
+    if (maze.empty())
+        return walls;
+    walls.assign(2 * maze.dims()[0] + 1, 2 * maze.dims()[1] + 1);
+    for (size_t v = 0; v < maze.cells(); ++v) {
+        const int r = int(v / maze.stride(0)), c = int(v % maze.stride(0));
+        if (maze.links(v) & 1)
+            walls.open(r, c, compact_walls::south);
+        if (maze.links(v) & 2)
+            walls.open(r, c, compact_walls::east);
+    }
+    return walls;
+}
+
+template class lattice<2>;
+template class lattice<3>;
+template class lattice<4>;
+
+}
@@ -1,5 +1,8 @@
 #include "driver.h"
+#include "cli.h"
 
-int main(){
+int main(int argc, char** argv){
+    if (argc > 1)
+        return cli_logic::run(argc, argv); // Batch mode: no prompts, no screen clearing
     return driver_logic::run();
-}
\ No newline at end of file
+}
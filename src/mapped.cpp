@@ -0,0 +1,319 @@
+#include "maze.h"
+#include <cstring>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace maze_gen {
+
+namespace {
+
+// Reads a little-endian word; a plain load on little-endian hosts.
+uint64_t load_u64(const unsigned char *p) {
+    uint64_t v;
+    std::memcpy(&v, p, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+
+}
+
+mapped_maze::mapped_maze()
+    : base_(nullptr), size_(0),
+#ifdef _WIN32
+      file_(INVALID_HANDLE_VALUE), mapping_(nullptr),
+#else
+      fd_(-1),
+#endif
+      raw_(false), row_bytes_(0), block_stride_(0) {
+}
+
+mapped_maze::~mapped_maze() {
+    close();
+}
+
+/*
+Maps a maze file. Only the header is read, and for compressed files the block
+heads; the payload size is checked against the file size so every row access
+stays inside the mapping.
+param filename File written by maze_generator::save.
+param error Receives a message on failure.
+return True if the file is mapped.
+ */
+bool mapped_maze::open(const std::string &filename, std::string &error) {
+    close();
+
+    std::ifstream in(filename, std::ios::binary);
+    if (!in) {
+        error = "cannot open " + filename;
+        return false;
+    }
+    if (!read_header(in, header_, error))
+        return false;
+    in.close();
+
+    const bool stored = header_.flags & FLAG_STORED;
+    raw_ = header_.flags & FLAG_RAW;
+    const int rows = raw_ ? height() : (height() - 1) / 2;
+    row_bytes_ = raw_ ? size_t(width()) : (size_t((width() - 1) / 2) * 2 + 63) / 64 * 8;
+    const size_t full_block = row_bytes_ * header_.rows_per_block;
+    block_stride_ = 8 + full_block + (8 - full_block % 8) % 8;
+    const size_t last_rows = rows - size_t(rows - 1) / header_.rows_per_block * header_.rows_per_block;
+    // Compressed blocks have no fixed stride; they are checked one by one once mapped
+    const size_t expected =
+        stored ? header_.payload_offset + size_t(rows - 1) / header_.rows_per_block * block_stride_ + 8 +
+                     last_rows * row_bytes_
+               : header_.payload_offset;
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    LARGE_INTEGER file_size;
+    if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &file_size)) {
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+        error = "cannot open " + filename;
+        return false;
+    }
+    file_ = file;
+    size_ = size_t(file_size.QuadPart);
+    if (size_ < expected) {
+        close();
+        error = "truncated file";
+        return false;
+    }
+    mapping_ = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    base_ = mapping_ ? static_cast<const unsigned char *>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+#else
+    fd_ = ::open(filename.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd_ < 0 || fstat(fd_, &st) != 0) {
+        close();
+        error = "cannot open " + filename;
+        return false;
+    }
+    size_ = size_t(st.st_size);
+    if (size_ < expected) {
+        close();
+        error = "truncated file";
+        return false;
+    }
+    void *p = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd_, 0);
+    base_ = p == MAP_FAILED ? nullptr : static_cast<const unsigned char *>(p);
+    if (base_)
+        madvise(p, size_, MADV_RANDOM); // Region queries touch scattered rows; skip readahead
+#endif
+    if (!base_) {
+        close();
+        error = "cannot map " + filename;
+        return false;
+    }
+    if (stored)
+        return true;
+
+    // Note where each block starts; a run-length block has to shrink its rows at least 64-fold
+    const size_t count = size_t(rows - 1) / header_.rows_per_block + 1;
+    blocks_.resize(count);
+    uint64_t at = header_.payload_offset;
+    for (size_t b = 0; b < count; ++b) {
+        if (at + 8 > size_) {
+            close();
+            error = "truncated file";
+            return false;
+        }
+        const uint32_t field = get_u32(base_ + at);
+        const size_t bytes = field & ~BLOCK_RLE, decoded = block_bytes(b);
+        if ((field & BLOCK_RLE) ? bytes < decoded / 64 || bytes > decoded + decoded / 64 + 16 : bytes != decoded) {
+            close();
+            error = "corrupt block size";
+            return false;
+        }
+        if (at + 8 + bytes > size_) {
+            close();
+            error = "truncated file";
+            return false;
+        }
+        blocks_[b] = at;
+        at += 8 + bytes + (8 - bytes % 8) % 8;
+    }
+    decoded_.resize(count);
+    ready_.reset(new std::atomic<const unsigned char *>[count]);
+    for (size_t b = 0; b < count; ++b)
+        ready_[b].store(nullptr, std::memory_order_relaxed);
+    return true;
+}
+
+void mapped_maze::close() {
+#ifdef _WIN32
+    if (base_)
+        UnmapViewOfFile(base_);
+    if (mapping_)
+        CloseHandle(mapping_);
+    if (file_ != INVALID_HANDLE_VALUE)
+        CloseHandle(file_);
+    mapping_ = nullptr;
+    file_ = INVALID_HANDLE_VALUE;
+#else
+    if (base_)
+        munmap(const_cast<unsigned char *>(base_), size_);
+    if (fd_ >= 0)
+        ::close(fd_);
+    fd_ = -1;
+#endif
+    base_ = nullptr;
+    size_ = 0;
+    blocks_.clear();
+    decoded_.clear();
+    ready_.reset();
+}
+
+// Decoded bytes of a block: rows_per_block rows, fewer in the last block.
+size_t mapped_maze::block_bytes(size_t block) const {
+    const size_t rows = raw_ ? size_t(height()) : size_t(height() - 1) / 2;
+    return row_bytes_ * std::min<size_t>(header_.rows_per_block, rows - block * header_.rows_per_block);
+}
+
+/*
+Returns the rows of a block, decoding a run-length block on first use. Safe to call
+from several threads; each block is decoded once.
+param block Block number.
+return The decoded rows; a block that fails to decode reads as all walls (verify reports it).
+ */
+const unsigned char *mapped_maze::block_data(size_t block) const {
+    if (blocks_.empty())
+        return base_ + header_.payload_offset + block * block_stride_ + 8;
+    const unsigned char *head = base_ + blocks_[block];
+    const uint32_t field = get_u32(head);
+    if (!(field & BLOCK_RLE))
+        return head + 8;
+    const unsigned char *data = ready_[block].load(std::memory_order_acquire);
+    if (data)
+        return data;
+
+    std::lock_guard<std::mutex> lock(decode_mutex_);
+    data = ready_[block].load(std::memory_order_relaxed);
+    if (!data) {
+        std::vector<unsigned char> &rows = decoded_[block];
+        rows.resize(block_bytes(block));
+        if (!rle_decode(head + 8, field & ~BLOCK_RLE, rows.data(), rows.size()))
+            std::fill(rows.begin(), rows.end(), raw_ ? (unsigned char)WALL : 0);
+        data = rows.data();
+        ready_[block].store(data, std::memory_order_release);
+    }
+    return data;
+}
+
+// Start of a stored row: logical cell row for packed files, grid row for raw ones.
+const unsigned char *mapped_maze::row_data(int row) const {
+    const size_t block = size_t(row) / header_.rows_per_block;
+    return block_data(block) + (size_t(row) - block * header_.rows_per_block) * row_bytes_;
+}
+
+// Passages through the border are masked, as compact_walls never holds them.
+unsigned mapped_maze::get(int r, int c) const {
+    const size_t bit = size_t(c) * 2;
+    const unsigned border = (c == (width() - 3) / 2 ? unsigned(compact_walls::east) : 0u) |
+                            (r == (height() - 3) / 2 ? unsigned(compact_walls::south) : 0u);
+    return unsigned(load_u64(row_data(r) + bit / 64 * 8) >> (bit % 64)) & 3 & ~border;
+}
+
+// Same answers as compact_walls::is_wall for packed files; raw files are read directly.
+bool mapped_maze::is_wall(int x, int y) const {
+    if (raw_)
+        return row_data(x)[y] == WALL;
+    const int h = height(), w = width();
+    if (x <= 0 || y <= 0 || x >= h - 1 || y >= w - 1)
+        return !((x == 0 && y == 1) || (x == h - 1 && y == w - 2));
+    if (x & 1) {
+        if (y & 1)
+            return false;
+        return !(get(x >> 1, (y >> 1) - 1) & compact_walls::east);
+    }
+    if (y & 1)
+        return !(get((x >> 1) - 1, y >> 1) & compact_walls::south);
+    return true;
+}
+
+/*
+Checks the stored checksum of every block and, in packed files, that no row opens
+a passage through the border (see packed_row_valid).
+param error Receives the first failing rows.
+return True if all blocks match.
+ */
+bool mapped_maze::verify(std::string &error) const {
+    const int rows = raw_ ? height() : (height() - 1) / 2;
+    std::vector<unsigned char> scratch;
+    std::vector<uint64_t> words;
+    for (int first = 0; first < rows; first += header_.rows_per_block) {
+        const int count = std::min<int>(header_.rows_per_block, rows - first);
+        const size_t block = size_t(first) / header_.rows_per_block;
+        const unsigned char *head =
+            blocks_.empty() ? base_ + header_.payload_offset + block * block_stride_ : base_ + blocks_[block];
+        const uint32_t field = get_u32(head);
+        const size_t bytes = row_bytes_ * count;
+        // Decoded into scratch rather than kept, so verifying does not hold the whole maze
+        const unsigned char *data = head + 8;
+        bool ok = field == bytes;
+        if (field & BLOCK_RLE) {
+            scratch.resize(bytes);
+            ok = rle_decode(head + 8, field & ~BLOCK_RLE, scratch.data(), bytes);
+            data = scratch.data();
+        }
+        if (!ok || crc32(data, bytes) != get_u32(head + 4)) {
+            error = "checksum mismatch in rows " + std::to_string(first) + "-" + std::to_string(first + count - 1);
+            return false;
+        }
+        for (int i = 0; !raw_ && i < count; ++i) {
+            words.resize(row_bytes_ / 8);
+            for (size_t w = 0; w < words.size(); ++w)
+                words[w] = load_u64(data + row_bytes_ * i + 8 * w);
+            if (!packed_row_valid(words.data(), words.size(), (width() - 1) / 2, first + i == rows - 1)) {
+                error = "corrupt passages in row " + std::to_string(first + i);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+template <typename View>
+void print_region(std::ostream &out, const region_view<View> &region, const std::vector<cell> *path) {
+    grid2d<char> marks(region.height(), region.width(), 0);
+    if (path)
+        for (size_t i = 0; i < path->size(); ++i) {
+            const cell &c = (*path)[i];
+            marks(c.x, c.y) = 1;
+            if (i > 0)
+                marks((c.x + (*path)[i - 1].x) / 2, (c.y + (*path)[i - 1].y) / 2) = 1;
+        }
+
+    std::string line;
+    for (int x = 0; x < region.height(); ++x) {
+        line.clear();
+        for (int y = 0; y < region.width(); ++y) {
+            if (marks(x, y)) {
+                line += RED;
+                line += PATH;
+                line += RESET;
+            } else {
+                line += region.is_wall(x, y) ? WALL : CELL;
+            }
+            line += CELL;
+        }
+        line += '\n';
+        out << line;
+    }
+    out << std::flush;
+}
+
+template void print_region<mapped_maze>(std::ostream &, const region_view<mapped_maze> &, const std::vector<cell> *);
+template void print_region<compact_walls>(std::ostream &, const region_view<compact_walls> &,
+                                          const std::vector<cell> *);
+
+}
@@ -1,49 +1,94 @@
 #include "maze.h"
 #include <cassert>
+#include <chrono>
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
 
 namespace maze_gen {
 
+namespace {
+
+constexpr int PLAY_FRAME_MS = 16;  // Shortest time between frames of play(), about 60 per second
+constexpr int PLAY_ESCAPE_MS = 50; // How long a lone ESC waits for the rest of an arrow key
+
+// Write end of the pipe play() watches for terminal resizes, -1 outside play()
+volatile sig_atomic_t resize_fd = -1;
+
+void on_resize(int) {
+    const int saved = errno;
+    if (resize_fd >= 0) {
+        const char byte = 0;
+        (void)!write(resize_fd, &byte, 1);
+    }
+    errno = saved;
+}
+
+// Offsets of the candidate neighbors, two positions away past the wall between: north, east, south, west.
+// The order matches dir_row/dir_col, so carve_maze draws exactly as carve_backtracker does in compact storage.
+constexpr int neighbor_dx[4] = {-2, 0, 2, 0};
+constexpr int neighbor_dy[4] = {0, 2, 0, -2};
+
+}
+
 // Carves paths in the maze starting from the given cell (x, y) using a depth-first search algorithm with backtracking.
+// Runs in O(cells): the remaining unvisited cells are tracked by a counter instead of rescanning the grid each step.
 void maze_generator::carve_maze(int x, int y) {
     // Ensure starting cell is valid: within bounds and at an odd index (cell position)
     assert(x > 0 && x < height && y > 0 && y < width && x % 2 == 1 && y % 2 == 1);
 
-    std::stack<cell> st;              // Stack for backtracking
+    std::vector<cell> &st = carve_stack; // Stack for backtracking, kept between mazes
+    st.clear();
     cell current_cell(x, y);          // Current position in the maze
-    current_maze.visited[x][y] = VISITED; // Mark starting cell as visited
     cell neighbor_cell;
+    size_t unvisited = count_unvisited(); // Cells left to carve into
+    size_t cursor = 0;                    // Scan position for jumps to disconnected regions
 
-    do {
-        std::vector<cell> neighbors = get_neighbors(current_cell); // Get unvisited neighbors
+    current_maze.visited(x, y) = VISITED; // Mark starting cell as visited
+    --unvisited;
+    size_t backtracks = 0, jumps = 0;
+    const size_t cells = unvisited + 1;
+
+    while (unvisited > 0) {
+        neighbor_list neighbors = get_neighbors(current_cell); // Get unvisited neighbors, no allocation
         if (neighbors.size() > 0) {
             // Choose a random neighbor and carve a path to it
-            std::shuffle(neighbors.begin(), neighbors.end(), rng);
-            neighbor_cell = neighbors[0];
-            st.push(current_cell);            // Save current cell for backtracking
+            neighbor_cell = neighbors[rng.bounded(neighbors.size())];
+            st.push_back(current_cell);       // Save current cell for backtracking
             remove_wall(current_cell, neighbor_cell); // Remove wall between cells
             current_cell = neighbor_cell;     // Move to the neighbor
-            current_maze.visited[current_cell.x][current_cell.y] = VISITED; // Mark as visited
+            current_maze.visited(current_cell.x, current_cell.y) = VISITED; // Mark as visited
+            --unvisited;
         } else if (st.size() > 0) {
             // Backtrack to the previous cell if no unvisited neighbors
-            st.pop();
-            current_cell = st.top();
-        } else if (if_unvisited()) {
-            // Jump to a random unvisited cell if stack is empty
-            std::vector<cell> unvisited = get_unvisited_cells();
-            std::shuffle(unvisited.begin(), unvisited.end(), rng);
-            current_cell = unvisited[0];
+            current_cell = st.back();
+            st.pop_back();
+            ++backtracks;
         } else {
-            break; // Exit when all cells are visited
+            // Stack is empty but cells remain: continue from the next unvisited cell.
+            // The cursor only moves forward, so all jumps together cost one pass over the grid.
+            current_cell = next_unvisited_cell(cursor);
+            current_maze.visited(current_cell.x, current_cell.y) = VISITED;
+            --unvisited;
+            ++jumps;
         }
-    } while (if_unvisited());
+    }
+    // Counted locally and added once, so profiling adds nothing to the loop
+    MAZE_PROFILE_COUNT(cells_visited, cells);
+    MAZE_PROFILE_COUNT(backtracks, backtracks);
+    MAZE_PROFILE_COUNT(random_jumps, jumps);
+    (void)backtracks;
+    (void)jumps;
+    (void)cells;
 }
 
 
  //Adds an entrance at the top-left (0,1) and an exit at the bottom-right (height-1, width-2) of the maze
 
 void maze_generator::add_entrance_and_exit() {
-    current_maze.grid[0][1] = CELL;           // Set entrance
-    current_maze.grid[height - 1][width - 2] = CELL; // Set exit
+    current_maze.grid(0, 1) = CELL;           // Set entrance
+    current_maze.grid(height - 1, width - 2) = CELL; // Set exit
 }
 
 /*
@@ -51,37 +96,172 @@ void maze_generator::add_entrance_and_exit() {
   return True if unvisited cells exist, false otherwise.
  */
 bool maze_generator::if_unvisited() const {
-    for (int i = 1; i < height; i += 2)       // Check only cell positions (odd indices)
-        for (int j = 1; j < width; j += 2)
-            if (!current_maze.visited[i][j])
-                return true;
+    MAZE_PROFILE_SCOPE(unvisited_scan);
+    for (int i = 1; i < height - 1; i += 2)   // Check only cell positions (odd indices)
+        if (simd::next_unvisited_in_row(current_maze.visited.row(i), 1, width - 1) < width - 1)
+            return true;
     return false;
 }
 
 /*
-Returns a vector of all unvisited cells in the maze.
-return Vector of unvisited cell coordinates.
+Counts the unvisited cell positions (odd indices) in the maze.
+return Number of cells that have not been carved into yet.
  */
-std::vector<cell> maze_generator::get_unvisited_cells() const {
-    std::vector<cell> res;
-    for (int i = 1; i < height; i += 2)       // Iterate over cell positions
-        for (int j = 1; j < width; j += 2)
-            if (!current_maze.visited[i][j]) {
-                cell c(i, j);
-                res.push_back(c);
-            }
+size_t maze_generator::count_unvisited() const {
+    MAZE_PROFILE_SCOPE(unvisited_scan);
+    size_t res = 0;
+    for (int i = 1; i < height - 1; i += 2)   // Iterate over cell positions
+        res += simd::count_unvisited_row(current_maze.visited.row(i), width - 1);
     return res;
 }
 
+/*
+Finds the next unvisited cell in row-major order, starting at the given cursor.
+param cursor Index of the first cell position to check; advanced past the returned cell.
+return Coordinates of the unvisited cell.
+ */
+cell maze_generator::next_unvisited_cell(size_t &cursor) const {
+    MAZE_PROFILE_SCOPE(unvisited_scan);
+    const size_t cols = (width - 1) / 2;
+    const size_t total = cols * ((height - 1) / 2);
+    while (cursor < total) {
+        // Scan the rest of the cursor's row a vector at a time
+        const size_t r = cursor / cols;
+        const int y = simd::next_unvisited_in_row(current_maze.visited.row(int(2 * r + 1)), int(2 * (cursor % cols) + 1),
+                                                  width - 1);
+        if (y < width - 1) {
+            cursor = r * cols + size_t(y / 2) + 1;
+            return cell(unsigned(2 * r + 1), unsigned(y));
+        }
+        cursor = (r + 1) * cols;
+    }
+    assert(false && "no unvisited cell left");
+    return cell(1, 1);
+}
+
+/*
+ Writes the compact maze one expanded row at a time, so printing never holds the full character grid.
+ param out Stream to write to.
+ param path Optional overlay whose open passages mark the solution, or null.
+ */
+void maze_generator::print_rows(std::ostream &out, const compact_walls *path) const {
+    const compact_walls &walls = current_maze.packed;
+    std::vector<char> row(walls.width());
+    std::vector<char> line(simd::text_row_capacity(walls.width()) + 1);
+    for (int x = 0; x < walls.height(); ++x) {
+        walls.expand_row(x, row.data());
+        if (path)
+            mark_path_row(*path, x, row.data());
+        size_t n = simd::expand_text_row(row.data(), walls.width(), line.data(), true);
+        line[n++] = '\n';
+        out.write(line.data(), std::streamsize(n));
+    }
+    out << std::flush;
+}
+
+// True once a maze has been generated or loaded in the current storage mode.
+bool maze_generator::has_maze() const {
+    return storage == storage_mode::compact ? !current_maze.packed.empty() : !current_maze.grid.empty();
+}
+
 //Default constructor: initializes maze dimensions to 0 and seeds the random number generator.
-maze_generator::maze_generator() : width(0), height(0), rng(std::random_device{}()) {}
+maze_generator::maze_generator() : width(0), height(0), storage(storage_mode::bytes), algorithm(maze_algorithm::backtracker), solver(solver_algorithm::bfs),
+      compress_files(true), verbose(true), seed(0), fixed_seed(false), threads(std::max(1u, std::thread::hardware_concurrency())), tile_cells(0) {}
 
 /*
  Parameterized constructor: sets maze dimensions and seeds the random number generator.
  param w Width of the maze.
  param h Height of the maze.
  */
-maze_generator::maze_generator(int w, int h) : width(w), height(h), rng(std::random_device{}()) {}
+maze_generator::maze_generator(int w, int h) : width(w), height(h), storage(storage_mode::bytes), algorithm(maze_algorithm::backtracker), solver(solver_algorithm::bfs),
+      compress_files(true), verbose(true), seed(0), fixed_seed(false), threads(std::max(1u, std::thread::hardware_concurrency())), tile_cells(0) {}
+
+/*
+ Selects how mazes are stored. Compact storage keeps two bits per cell and supports
+ the same generate/print/save/load/solve/play operations as the byte grid.
+ Switching modes discards the current maze.
+ param mode The storage mode to use.
+ */
+void maze_generator::set_storage(storage_mode mode) {
+    if (mode != storage)
+        current_maze = maze();
+    storage = mode;
+}
+
+storage_mode maze_generator::get_storage() const {
+    return storage;
+}
+
+/*
+ Selects the algorithm generate_maze() carves with.
+ param algo The generation algorithm.
+ */
+void maze_generator::set_algorithm(maze_algorithm algo) {
+    algorithm = algo;
+}
+
+maze_algorithm maze_generator::get_algorithm() const {
+    return algorithm;
+}
+
+/*
+ Selects the algorithm solve() uses.
+ param algo The search algorithm.
+ */
+void maze_generator::set_solver(solver_algorithm algo) {
+    solver = algo;
+}
+
+solver_algorithm maze_generator::get_solver() const {
+    return solver;
+}
+
+/*
+ Sets the dimensions of the following mazes without prompting.
+ param w, h Odd grid dimensions greater than 3.
+ */
+void maze_generator::set_size(int w, int h) {
+    width = w;
+    height = h;
+}
+
+/*
+ Fixes the seed so every following generate_maze() call builds the same maze
+ for the same dimensions, storage-independent settings and tile size.
+ param s The seed.
+ */
+void maze_generator::set_seed(uint64_t s) {
+    seed = s;
+    fixed_seed = true;
+}
+
+// Goes back to drawing a fresh random seed for every maze.
+void maze_generator::clear_seed() {
+    fixed_seed = false;
+}
+
+// Returns the seed of the most recently generated maze.
+uint64_t maze_generator::get_seed() const {
+    return seed;
+}
+
+/*
+ Sets the number of worker threads used by tiled generation and solver_algorithm::parallel.
+ param n Thread count; values below 1 use one thread per hardware core.
+ */
+void maze_generator::set_threads(int n) {
+    threads = n > 0 ? n : std::max(1u, std::thread::hardware_concurrency());
+}
+
+/*
+ Enables tiled generation: the maze is carved as square tiles on worker threads and
+ the tiles are joined into one perfect maze. The result depends on the seed and tile
+ size only, never on the thread count.
+ param cells Tile side in logical cells (rounded up to a multiple of 32); 0 carves one tree from (1,1).
+ */
+void maze_generator::set_tile_size(int cells) {
+    tile_cells = std::max(0, cells);
+}
 
 /**
  Prompts the user to input odd numbers greater than 3 for maze width and height.
@@ -139,30 +319,56 @@ void maze_generator::generate_maze() {
         return;
     }
 
-    std::cout << "Generating maze..." << std::endl;
-
-    rng.seed(std::random_device{}()); // Reseed RNG for randomness
-
-    current_maze = maze(width, height); // Initialize maze object
+    if (verbose)
+        std::cout << "Generating maze..." << std::endl;
+
+    index.clear(); // Built for the previous maze
+    field.clear();
+    if (!fixed_seed) // Draw a fresh seed for randomness; it stays readable through get_seed()
+        seed = (uint64_t(std::random_device{}()) << 32) | std::random_device{}();
+    rng.seed(mix_seed(seed, 0));
+
+    // Reuse the buffers of the previous maze; batch runs generate many mazes of one size
+    current_maze.width = width;
+    current_maze.height = height;
+    current_maze.name = "Unnamed";
+
+    if (storage == storage_mode::compact) {
+        {
+            MAZE_PROFILE_SCOPE(grid_init);
+            current_maze.grid = grid2d<char>();
+            current_maze.visited = grid2d<unsigned char>();
+            current_maze.packed.assign(height, width); // Every passage closed
+        }
+        MAZE_PROFILE_SCOPE(carve);
+        carve_target target(current_maze.packed);
+        if (tile_cells > 0)
+            carve_tiled(target, strategy_for(algorithm), seed, tile_cells, threads);
+        else
+            strategy_for(algorithm).carve(target, {0, 0, target.rows(), target.cols()}, rng);
+        return;
+    }
 
-    // Resize grid and visited arrays
-    current_maze.grid.resize(height);
-    current_maze.visited.resize(height);
+    {
+        MAZE_PROFILE_SCOPE(grid_init);
+        current_maze.packed.clear();
+        current_maze.grid.assign(height, width, WALL);
+        current_maze.visited.assign(height, width, false);
 
-    for (int i = 0; i < height; ++i) {
-        current_maze.grid[i].resize(width);
-        current_maze.visited[i].resize(width);
-        for (int j = 0; j < width; ++j) {
-            // Set cells at odd indices, walls elsewhere
-            if (i % 2 != 0 && j % 2 != 0 && (i < height - 1) && (j < width - 1)) {
-                current_maze.grid[i][j] = CELL;
-            } else {
-                current_maze.grid[i][j] = WALL;
-            }
-            current_maze.visited[i][j] = false;
-        }
+        // Set cells at odd indices, walls elsewhere
+        for (int i = 1; i < height - 1; i += 2)
+            simd::fill_lattice_row(current_maze.grid.row(i), width);
+    }
+    MAZE_PROFILE_SCOPE(carve);
+    if (tile_cells > 0) {
+        carve_target target(current_maze.grid);
+        carve_tiled(target, strategy_for(algorithm), seed, tile_cells, threads);
+    } else if (algorithm == maze_algorithm::backtracker) {
+        carve_maze(1, 1);     // Start carving from (1,1)
+    } else {
+        carve_target target(current_maze.grid);
+        strategy_for(algorithm).carve(target, {0, 0, target.rows(), target.cols()}, rng);
     }
-    carve_maze(1, 1);         // Start carving from (1,1)
     add_entrance_and_exit();  // Add entrance and exit
 }
 
@@ -172,37 +378,23 @@ void maze_generator::print_maze() const {
         std::cout << "Please define width and height and/or load pre-made maze" << std::endl;
         return;
     }
-    std::stringstream ss;
-    ss << "Viewing " << current_maze.name << " maze" << std::endl;
 
-    for (const auto &row : current_maze.grid) {
-        for (char cell : row)
-            ss << cell << CELL;
-        ss << std::endl;
-    }
-
-    std::cout << ss.str();
+    // One line buffer reused for every row instead of streaming each position
+    std::cout << "Viewing " << current_maze.name << " maze" << std::endl;
+    text_sink sink(std::cout);
+    write_rows(sink);
 }
 
- //Returns a vector of unvisited neighboring cells that are not walls.
+ //Returns the unvisited neighboring cells that are not walls.
  //param c The current cell.
- //return Vector of neighboring cells.
-std::vector<cell> maze_generator::get_neighbors(cell &c) const {
-    std::vector<cell> res;
-    std::vector<cell> cells;
-
-    // Define potential neighbors (2 steps away due to wall spacing)
-    cell up(c.x, c.y - 2);
-    cell rt(c.x + 2, c.y);
-    cell dw(c.x, c.y + 2);
-    cell lt(c.x - 2, c.y);
-
-    cells.insert(cells.end(), {up, rt, dw, lt});
-
-    for (cell neighb : cells) {
-        if (neighb.x < height && neighb.y < width && neighb.x > 0 && neighb.y > 0 &&
-            current_maze.grid[neighb.x][neighb.y] != WALL && !current_maze.visited[neighb.x][neighb.y]) {
-            res.push_back(neighb);
+ //return Up to four neighboring cells, stored inline.
+neighbor_list maze_generator::get_neighbors(const cell &c) const {
+    neighbor_list res;
+    for (int d = 0; d < 4; ++d) {
+        cell neighb(c.x + neighbor_dx[d], c.y + neighbor_dy[d]); // Out-of-range moves wrap and fail the bounds test
+        if (neighb.x < unsigned(height) && neighb.y < unsigned(width) && neighb.x > 0 && neighb.y > 0 &&
+            current_maze.grid(neighb.x, neighb.y) != WALL && !current_maze.visited(neighb.x, neighb.y)) {
+            res.cells[res.count++] = neighb;
         }
     }
     return res;
@@ -223,45 +415,80 @@ void maze_generator::remove_wall(cell &first, cell &second) {
     short int addx = (xdiff != 0) ? (xdiff / abs(xdiff)) : 0; // Direction in x
     short int addy = (ydiff != 0) ? (ydiff / abs(ydiff)) : 0; // Direction in y
 
-    current_maze.grid[first.x + addx][first.y + addy] = CELL; // Remove wall
-    current_maze.visited[first.x + addx][first.y + addy] = VISITED; // Mark as visited
+    current_maze.grid(first.x + addx, first.y + addy) = CELL; // Remove wall
+    current_maze.visited(first.x + addx, first.y + addy) = VISITED; // Mark as visited
 }
 
 /*
-Saves the current maze to a binary file.
+Saves the current maze to a binary file in the versioned format (see format.h).
+Standard mazes are stored as packed passage bits; other grids as raw bytes.
 param filename The name of the file to save to.
+return True if the file was written.
  */
-void maze_generator::save(const std::string &filename) {
+bool maze_generator::save(const std::string &filename) {
+    if (!has_maze()) {
+        std::cout << "Please generate or load maze first" << std::endl;
+        return false;
+    }
+
+    MAZE_PROFILE_SCOPE(save);
     current_maze.name = filename;
 
     std::ofstream file(filename, std::ios::binary);
 
     if (!file || !file.is_open()) {
         std::cerr << "Error opening file" << std::endl;
-        return;
+        return false;
     }
 
-    size_t name_length = current_maze.name.size();
-    // Serialize maze data: name length, name, dimensions, grid
-    file.write(reinterpret_cast<const char *>(&name_length), sizeof(name_length));
-    file.write(current_maze.name.data(), name_length);
-    file.write(reinterpret_cast<const char *>(&current_maze.height), sizeof(current_maze.height));
-    file.write(reinterpret_cast<const char *>(&current_maze.width), sizeof(current_maze.width));
-
-    for (const auto &row : current_maze.grid) {
-        file.write(row.data(), row.size());
+    if (storage == storage_mode::compact) {
+        const compact_walls &walls = current_maze.packed;
+        maze_writer writer(file, current_maze.name, walls.height(), walls.width(), false, compress_files);
+        for (int r = 0; r < walls.rows(); ++r)
+            writer.write_row(walls.plane().row_words(r));
+        writer.finish();
+    } else if (is_standard_layout(current_maze.grid)) {
+        // Pack the passages; the packed copy costs 2 bits per cell
+        compact_walls walls;
+        walls.assign(current_maze.height, current_maze.width);
+        for (int x = 0; x < current_maze.height; ++x)
+            walls.pack_row(x, current_maze.grid.row(x));
+        maze_writer writer(file, current_maze.name, walls.height(), walls.width(), false, compress_files);
+        for (int r = 0; r < walls.rows(); ++r)
+            writer.write_row(walls.plane().row_words(r));
+        writer.finish();
+    } else {
+        maze_writer writer(file, current_maze.name, current_maze.height, current_maze.width, true, compress_files);
+        for (int x = 0; x < current_maze.height; ++x)
+            writer.write_row(current_maze.grid.row(x));
+        writer.finish();
     }
 
+    if (!file) {
+        std::cerr << "Error writing file" << std::endl;
+        return false;
+    }
+    MAZE_PROFILE_COUNT(bytes_written, file.tellp());
     file.close();
-    std::cout << "Maze successfully saved to " << filename << std::endl;
+    if (verbose)
+        std::cout << "Maze successfully saved to " << filename << std::endl;
+
+    // A built path index is kept next to the maze so loading it skips the rebuild
+    std::string error;
+    if (!index.empty() && !index.save(filename + ".idx", error))
+        std::cerr << "Error saving path index: " << error << std::endl;
+    return true;
 }
 
 /*
-Loads a maze from a binary file.
+Loads a maze from a binary file, in the versioned format or the original one.
+Rebuilds everything derived from the file: dimensions, storage for the current
+mode and a cleared visited plane.
 param filename The name of the file to load from.
 return True if loading succeeds, false otherwise.
  */
 bool maze_generator::load(const std::string &filename) {
+    MAZE_PROFILE_SCOPE(load);
     std::ifstream file(filename, std::ios::binary);
 
     if (!file || !file.is_open()) {
@@ -269,184 +496,561 @@ bool maze_generator::load(const std::string &filename) {
         return false;
     }
 
-    size_t name_length;
-    // Deserialize maze data: name length, name, dimensions, grid
-    file.read(reinterpret_cast<char *>(&name_length), sizeof(name_length));
-    current_maze.name.resize(name_length);
-    file.read(&current_maze.name[0], name_length);
-    file.read(reinterpret_cast<char *>(&current_maze.height), sizeof(current_maze.height));
-    file.read(reinterpret_cast<char *>(&current_maze.width), sizeof(current_maze.width));
+    char magic[4] = {0};
+    file.read(magic, 4);
+    file.clear();
+    file.seekg(0);
+
+    maze loaded;
+    if (std::equal(magic, magic + 4, FORMAT_MAGIC)) {
+        maze_header header;
+        std::string error;
+        if (!read_header(file, header, error) || !read_payload(file, header, loaded.packed, loaded.grid, error)) {
+            std::cerr << "Error loading file: " << error << std::endl;
+            return false;
+        }
+        loaded.name = header.name;
+        loaded.height = int(header.height);
+        loaded.width = int(header.width);
+    } else if (!load_original_format(file, loaded)) {
+        std::cerr << "Error loading file: not a maze file or truncated" << std::endl;
+        return false;
+    }
+    MAZE_PROFILE_COUNT(bytes_read, file.tellg());
 
-    current_maze.grid.assign(current_maze.height, std::vector<char>(current_maze.width));
-    for (auto &row : current_maze.grid) {
-        file.read(row.data(), row.size());
+    // Convert to the representation of the current storage mode
+    if (storage == storage_mode::compact && loaded.packed.empty()) {
+        if (!is_standard_layout(loaded.grid)) {
+            std::cerr << "Error loading file: this maze cannot be held in compact storage" << std::endl;
+            return false;
+        }
+        loaded.packed.assign(loaded.height, loaded.width);
+        for (int x = 0; x < loaded.height; ++x)
+            loaded.packed.pack_row(x, loaded.grid.row(x));
+        loaded.grid.clear();
+    } else if (storage == storage_mode::bytes && !loaded.packed.empty()) {
+        loaded.grid.assign(loaded.height, loaded.width);
+        for (int x = 0; x < loaded.height; ++x)
+            loaded.packed.expand_row(x, loaded.grid.row(x));
+        loaded.packed.clear();
     }
+    if (storage == storage_mode::bytes)
+        loaded.visited.assign(loaded.height, loaded.width, false);
 
+    current_maze = std::move(loaded);
+    field.clear();
     width = current_maze.width;
     height = current_maze.height;
     file.close();
 
-    std::cout << "Maze " << current_maze.name << " successfully loaded" << std::endl;
+    // Use the saved path index when there is one for this exact maze
+    std::string error;
+    if (!index.load(filename + ".idx", height, width, fingerprint(), error) && verbose && !error.empty())
+        std::cerr << "Ignoring path index: " << error << std::endl;
+
+    if (verbose)
+        std::cout << "Maze " << current_maze.name << " successfully loaded" << std::endl;
+    return true;
+}
+
+/*
+Reads a file in the original format: host size_t name length, name, host int
+height and width, then one byte per grid position.
+param file Stream positioned at the start of the file.
+param loaded Receives name, dimensions and grid.
+return True if the file was complete.
+ */
+bool maze_generator::load_original_format(std::istream &file, maze &loaded) {
+    size_t name_length = 0;
+    // Deserialize maze data: name length, name, dimensions, grid
+    file.read(reinterpret_cast<char *>(&name_length), sizeof(name_length));
+    if (!file || name_length > (1u << 20))
+        return false;
+    loaded.name.resize(name_length);
+    file.read(&loaded.name[0], name_length);
+    file.read(reinterpret_cast<char *>(&loaded.height), sizeof(loaded.height));
+    file.read(reinterpret_cast<char *>(&loaded.width), sizeof(loaded.width));
+    if (!file || loaded.height < 3 || loaded.width < 3)
+        return false;
+    const uint64_t total = uint64_t(loaded.height) * uint64_t(loaded.width);
+    if (total > MAX_PAYLOAD_BYTES || total > stream_bytes_left(file))
+        return false;
+
+    loaded.grid.assign(loaded.height, loaded.width);
+    file.read(loaded.grid.data(), loaded.grid.size());
+    return bool(file);
+}
+
+/*
+ Chooses whether save() run-length encodes file blocks. Uncompressed files can be
+ memory-mapped without decoding.
+ param enabled True to compress.
+ */
+void maze_generator::set_compression(bool enabled) {
+    compress_files = enabled;
+}
+
+// Turns the status messages of generate_maze, save and load on or off.
+void maze_generator::set_verbose(bool enabled) {
+    verbose = enabled;
+}
+
+/*
+Emits the current maze row by row, in either storage mode.
+param sink Receives the grid rows.
+ */
+void maze_generator::write_rows(row_sink &sink) const {
+    if (!has_maze())
+        return;
+    MAZE_PROFILE_SCOPE(print);
+    sink.begin(current_maze.height, current_maze.width);
+    if (storage == storage_mode::compact) {
+        std::vector<char> row(current_maze.width);
+        for (int x = 0; x < current_maze.height; ++x) {
+            current_maze.packed.expand_row(x, row.data());
+            sink.row(row.data(), current_maze.width);
+        }
+    } else {
+        for (int x = 0; x < current_maze.height; ++x)
+            sink.row(current_maze.grid.row(x), current_maze.width);
+    }
+    sink.end();
+}
+
+/*
+Writes the current maze, or the region of opts, as an image.
+param filename Path of the image file.
+param opts Format, scale and region; threads 0 uses the generator's thread count.
+param with_path Draw the path from the entrance to the exit found with the current solver.
+return False if there is no maze, the region is empty or the file could not be written.
+ */
+bool maze_generator::save_image(const std::string &filename, const image_options &opts, bool with_path) const {
+    if (!has_maze()) {
+        std::cout << "Please generate or load maze first" << std::endl;
+        return false;
+    }
+    std::ofstream file(filename, std::ios::binary);
+    if (!file) {
+        std::cerr << "Error opening file" << std::endl;
+        return false;
+    }
+
+    image_options settings = opts;
+    if (settings.threads <= 0)
+        settings.threads = threads;
+    compact_walls path;
+    if (with_path) {
+        solve_result res = find_path(solver, cell(1, 1), cell(current_maze.height - 2, current_maze.width - 2));
+        path.assign(current_maze.height, current_maze.width);
+        trace_path(res.path, path);
+    }
+    const compact_walls *overlay = with_path ? &path : nullptr;
+    const bool written = storage == storage_mode::compact
+                             ? write_image(file, current_maze.packed, overlay, settings)
+                             : write_image(file, grid_view(current_maze.grid), overlay, settings);
+    if (!written)
+        std::cerr << "Error writing file" << std::endl;
+    return written;
+}
+
+/*
+Maps a saved maze and shows one region of it, solved from its top-left to its
+bottom-right cell. Only the rows of the region are read from the file; the
+current maze is left untouched; compressed blocks are decoded only where the region
+lies.
+param filename File written by save.
+param top, left First grid row and column, rounded down to even.
+param rows, cols Region size in grid positions, made odd and clipped to the maze.
+return True if the file could be mapped.
+ */
+bool maze_generator::inspect(const std::string &filename, int top, int left, int rows, int cols) const {
+    const auto started = std::chrono::steady_clock::now();
+    mapped_maze mapped;
+    std::string error;
+    if (!mapped.open(filename, error)) {
+        std::cerr << "Error mapping file: " << error << std::endl;
+        return false;
+    }
+    const double open_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+
+    top = std::min(std::max(top, 0) & ~1, mapped.height() - 3);
+    left = std::min(std::max(left, 0) & ~1, mapped.width() - 3);
+    rows = std::min(std::max(rows, 3) | 1, mapped.height() - top);
+    cols = std::min(std::max(cols, 3) | 1, mapped.width() - left);
+    region_view<mapped_maze> region(mapped, top, left, rows, cols);
+
+    solve_result res = maze_gen::find_path(region, solver, cell(1, 1), cell(rows - 2, cols - 2));
+    std::cout << "Viewing " << mapped.name() << " (" << mapped.height() << "x" << mapped.width() << ") rows " << top
+              << "-" << top + rows - 1 << ", columns " << left << "-" << left + cols - 1 << ", mapped in " << open_ms
+              << " ms" << std::endl;
+    print_region(std::cout, region, res.found ? &res.path : nullptr);
+    if (res.found)
+        std::cout << "Solved region with " << solver_name(solver) << ": " << res.path.size() << " cells on path, "
+                  << res.stats.nodes_expanded << " nodes expanded in " << res.stats.elapsed_ms << " ms" << std::endl;
+    else
+        std::cout << "No path across the region" << std::endl;
     return true;
 }
 
 /*
- Returns a vector of neighboring cells for the solver, checking for walls between them.
+ Returns the neighboring cells for the solver, checking for walls between them.
  param c The current cell.
- return Vector of reachable neighboring cells.
+ return Up to four reachable neighboring cells, stored inline.
  */
-std::vector<cell> maze_generator::get_neighbors_solver(cell &c) const {
-    std::vector<cell> res;
-    std::vector<cell> cells;
-
-    // Define potential neighbors
-    cell up(c.x, c.y - 2);
-    cell rt(c.x + 2, c.y);
-    cell dw(c.x, c.y + 2);
-    cell lt(c.x - 2, c.y);
-
-    cells.insert(cells.end(), {up, rt, dw, lt});
-
-    for (cell neighb : cells) {
-        if (neighb.x < height && neighb.y < width && neighb.x > 0 && neighb.y > 0 &&
-            current_maze.grid[neighb.x][neighb.y] != WALL && !current_maze.visited[neighb.x][neighb.y] &&
-            current_maze.grid[(neighb.x + c.x) / 2][(neighb.y + c.y) / 2] != WALL) { // Check wall between
-            res.push_back(neighb);
+neighbor_list maze_generator::get_neighbors_solver(const cell &c) const {
+    neighbor_list res;
+    for (int d = 0; d < 4; ++d) {
+        cell neighb(c.x + neighbor_dx[d], c.y + neighbor_dy[d]);
+        if (neighb.x < unsigned(height) && neighb.y < unsigned(width) && neighb.x > 0 && neighb.y > 0 &&
+            current_maze.grid(neighb.x, neighb.y) != WALL && !current_maze.visited(neighb.x, neighb.y) &&
+            current_maze.grid((neighb.x + c.x) / 2, (neighb.y + c.y) / 2) != WALL) { // Check wall between
+            res.cells[res.count++] = neighb;
         }
     }
     return res;
 }
 
-//Solves the maze using a stack-based approach and displays the solution.
+/*
+Finds a path between two cells without printing anything. A breadth-first search
+from the entrance cell reads its path off the tracked distance field when there is
+one; the statistics then describe that walk rather than a search.
+param algo Search algorithm to use.
+param start Start cell (odd grid coordinates).
+param goal Goal cell (odd grid coordinates).
+return The path from start to goal and search statistics; found is false if there is no maze or no path.
+ */
+solve_result maze_generator::find_path(solver_algorithm algo, const cell &start, const cell &goal) const {
+    if (!has_maze())
+        return solve_result();
+    if (algo == solver_algorithm::bfs && !field.empty() && start.x == 1 && start.y == 1)
+        return field.path(goal); // Already known from the tracked distances
+    if (storage == storage_mode::compact)
+        return maze_gen::find_path(current_maze.packed, algo, start, goal, threads);
+    return maze_gen::find_path(grid_view(current_maze.grid), algo, start, goal, threads);
+}
+
+/*
+Builds the path index of the current maze, after which get_index() answers
+distance and path queries between any two cells without searching. save()
+writes the index next to the maze and load() picks it up again.
+return False if there is no maze or it is not perfect (it has loops or unreachable cells).
+ */
+bool maze_generator::build_index() {
+    if (!has_maze())
+        return false;
+    std::string error;
+    const bool built = storage == storage_mode::compact ? index.build(current_maze.packed, error)
+                                                        : index.build(grid_view(current_maze.grid), error);
+    if (!built)
+        std::cerr << "Cannot index maze: " << error << std::endl;
+    return built;
+}
+
+/*
+Starts keeping the distance of every cell from the entrance. From then on
+open_wall and close_wall update the distances instead of invalidating them, and
+find_path from the entrance reads its path off them without searching.
+Generating or loading another maze stops tracking.
+ */
+void maze_generator::track_distances() {
+    if (!has_maze())
+        return;
+    if (storage == storage_mode::compact)
+        field.build(current_maze.packed);
+    else
+        field.build(grid_view(current_maze.grid));
+}
 
+/*
+Opens the wall on one side of a cell, as a level editor would.
+param c Cell position (odd coordinates).
+param dir Side of the cell: 0 north, 1 east, 2 south, 3 west.
+return False if there is no maze or the wall does not separate two cells.
+ */
+bool maze_generator::open_wall(const cell &c, int dir) {
+    return edit_wall(c, dir, false);
+}
+
+// Closes the wall on one side of a cell; see open_wall.
+bool maze_generator::close_wall(const cell &c, int dir) {
+    return edit_wall(c, dir, true);
+}
+
+bool maze_generator::edit_wall(const cell &c, int dir, bool wall) {
+    if (!has_maze() || dir < 0 || dir > 3 || c.x % 2 == 0 || c.y % 2 == 0)
+        return false;
+    const int x = int(c.x) + dir_row[dir], y = int(c.y) + dir_col[dir];
+    if (x <= 0 || y <= 0 || x >= current_maze.height - 1 || y >= current_maze.width - 1)
+        return false; // The border, or c is outside the maze
+    if (storage == storage_mode::compact) {
+        if (wall)
+            current_maze.packed.close(int(c.x / 2) - (dir == 0), int(c.y / 2) - (dir == 3),
+                                      dir % 2 ? compact_walls::east : compact_walls::south);
+        else
+            current_maze.packed.carve(int(c.x / 2), int(c.y / 2), dir);
+    } else {
+        current_maze.grid(x, y) = wall ? WALL : CELL;
+    }
+    index.clear(); // Only valid for the maze it was built for
+    if (!field.empty()) {
+        if (wall)
+            field.close(c, dir);
+        else
+            field.open(c, dir);
+    }
+    return true;
+}
+
+/*
+Measures dead ends, corridors, branching, the solution and the diameter of the
+current maze. Uses the thread count of set_threads for the cell passes.
+return The analysis; all zero if there is no maze.
+ */
+maze_analysis maze_generator::analyze() const {
+    if (!has_maze())
+        return maze_analysis();
+    if (storage == storage_mode::compact)
+        return analyze_maze(current_maze.packed, threads);
+    return analyze_maze(grid_view(current_maze.grid), threads);
+}
+
+// CRC of the passages of the current maze; identifies it to a saved path index.
+uint32_t maze_generator::fingerprint() const {
+    if (storage == storage_mode::compact)
+        return maze_fingerprint(current_maze.packed);
+    return maze_fingerprint(grid_view(current_maze.grid));
+}
+
+//Solves the maze from the entrance cell to the exit cell with the selected solver and displays the solution.
 void maze_generator::solve() {
+    solve(solver, cell(1, 1), cell(current_maze.height - 2, current_maze.width - 2));
+}
+
+/*
+Solves the maze between two cells and displays the solution with its search statistics.
+param algo Search algorithm to use.
+param start Start cell (odd grid coordinates).
+param goal Goal cell (odd grid coordinates).
+ */
+void maze_generator::solve(solver_algorithm algo, const cell &start, const cell &goal) {
     // Ensure maze is initialized
-    assert(current_maze.grid.size() > 0);
+    assert(has_maze());
 
-    if (current_maze.grid.size() <= 0) {
+    if (!has_maze()) {
         std::cout << "Please generate or load maze first" << std::endl;
         return;
     }
-    std::stack<cell> solution;
-    cell current_cell(1, 1);         // Start at entrance
-    cell neighbor_cell;
-    std::vector<std::vector<char>> solved_grid = current_maze.grid; // Copy grid for solution
-
-    // Reset visited array
-    for (int i = 0; i < height; ++i)
-        for (int j = 0; j < width; ++j)
-            current_maze.visited[i][j] = false;
 
-    current_maze.visited[1][1] = VISITED;
+    solve_result res = find_path(algo, start, goal);
+    if (!res.found) {
+        std::cout << "No path between (" << start.x << "," << start.y << ") and (" << goal.x << "," << goal.y << ")"
+                  << std::endl;
+        return;
+    }
 
-    do {
-        std::vector<cell> neighbors = get_neighbors_solver(current_cell);
-        if (neighbors.size() > 0) {
-            // Move to a neighbor and mark the path
-            solution.push(current_cell);
-            solved_grid[current_cell.x][current_cell.y] = PATH;
-            current_maze.visited[current_cell.x][current_cell.y] = VISITED;
-            std::shuffle(neighbors.begin(), neighbors.end(), rng);
-            neighbor_cell = neighbors[0];
-            solution.push(neighbor_cell);
-            solved_grid[(current_cell.x + neighbor_cell.x) / 2][(current_cell.y + neighbor_cell.y) / 2] = PATH;
-            solved_grid[neighbor_cell.x][neighbor_cell.y] = PATH;
-            current_maze.visited[neighbor_cell.x][neighbor_cell.y] = VISITED;
-            current_cell = neighbor_cell;
-        } else {
-            // Backtrack by removing the last step
-            solution.pop();
-            solved_grid[current_cell.x][current_cell.y] = CELL;
-            solved_grid[(current_cell.x + solution.top().x) / 2][(current_cell.y + solution.top().y) / 2] = CELL;
-            current_cell = solution.top();
-            solved_grid[current_cell.x][current_cell.y] = CELL;
+    std::cout << "Viewing solved " << current_maze.name << " maze" << std::endl;
+
+    if (storage == storage_mode::compact) {
+        // Record the path as open passages of an overlay and print row by row
+        compact_walls path;
+        path.assign(current_maze.height, current_maze.width);
+        trace_path(res.path, path);
+        print_rows(std::cout, &path);
+    } else {
+        grid2d<char> solved_grid = current_maze.grid; // Copy grid for solution
+        for (size_t i = 0; i < res.path.size(); ++i) {
+            const cell &c = res.path[i];
+            solved_grid(c.x, c.y) = PATH;
+            if (i > 0) // Passage from the previous cell
+                solved_grid((c.x + res.path[i - 1].x) / 2, (c.y + res.path[i - 1].y) / 2) = PATH;
         }
-    } while (current_cell.x != height - 2 || current_cell.y != width - 2); // Until exit is reached
 
-    std::stringstream ss;
-    ss << "Viewing solved " << current_maze.name << " maze" << std::endl;
-
-    // Print solved maze with path highlighted
-    for (const auto &row : solved_grid) {
-        for (char cell : row)
-            if (cell == '*') {
-                ss << RED << cell << RESET << CELL;
-            } else {
-                ss << cell << CELL;
-            }
-        ss << std::endl;
+        // Print solved maze with path highlighted, one row buffer at a time
+        std::vector<char> line(simd::text_row_capacity(solved_grid.cols()) + 1);
+        for (int i = 0; i < solved_grid.rows(); ++i) {
+            size_t n = simd::expand_text_row(solved_grid.row(i), solved_grid.cols(), line.data(), true);
+            line[n++] = '\n';
+            std::cout.write(line.data(), std::streamsize(n));
+        }
+        std::cout << std::flush;
     }
 
-    std::cout << ss.str();
+    std::cout << "Solved with " << solver_name(algo) << ": " << res.path.size() << " cells on path, "
+              << res.stats.nodes_expanded << " nodes expanded in " << res.stats.elapsed_ms << " ms" << std::endl;
 }
 
 /*
-Allows the user to play the maze using WASD keys in the terminal.
+Allows the user to play the maze with WASD or the arrow keys in the terminal.
 Note: Uses Unix-specific terminal settings (termios), may not work on all platforms.
 */
 void maze_generator::play() const {
     // Ensure maze is initialized
-    assert(current_maze.grid.size() > 0);
+    assert(has_maze());
 
-    if (current_maze.grid.size() <= 0) {
+    if (!has_maze()) {
         std::cout << "Please generate or load maze first" << std::endl;
         return;
     }
 
     // Save current terminal settings
     termios original_attributes;
-    tcgetattr(STDIN_FILENO, &original_attributes);
+    const bool tty = tcgetattr(STDIN_FILENO, &original_attributes) == 0;
 
     // Modify terminal settings: disable canonical mode and echo for real-time input
-    termios modified_attributes = original_attributes;
-    modified_attributes.c_lflag &= ~(ICANON | ECHO);
-    modified_attributes.c_cc[VMIN] = 0;  // Do not wait for input
-    modified_attributes.c_cc[VTIME] = 0; // Return immediately
-    tcsetattr(STDIN_FILENO, TCSANOW, &modified_attributes);
+    if (tty) {
+        termios modified_attributes = original_attributes;
+        modified_attributes.c_lflag &= ~(ICANON | ECHO);
+        modified_attributes.c_cc[VMIN] = 1;  // poll() does the waiting; read() returns what arrived
+        modified_attributes.c_cc[VTIME] = 0;
+        tcsetattr(STDIN_FILENO, TCSANOW, &modified_attributes);
+    }
 
-    std::vector<std::vector<char>> play_grid = current_maze.grid; // Copy grid for playing
+    std::cout.flush();
+    play(STDIN_FILENO, STDOUT_FILENO);
+
+    // Restore original terminal settings
+    if (tty)
+        tcsetattr(STDIN_FILENO, TCSANOW, &original_attributes);
+}
+
+/*
+Runs the game on a pair of descriptors. The loop sleeps in poll() until a key
+arrives or the terminal is resized, and draws at most one frame per
+PLAY_FRAME_MS, so a burst of input (or a held key repeating) is applied in full
+and shown in a single frame. Any descriptor works for input: a pipe of scripted
+keys plays the maze without a terminal, and the game ends at end of input.
+param in_fd Descriptor the keys are read from.
+param out_fd Descriptor the frames are written to.
+return Outcome of the game.
+ */
+play_stats maze_generator::play(int in_fd, int out_fd) const {
+    play_stats stats;
+    if (!has_maze())
+        return stats;
+
+    // Read walls straight from the maze in either storage mode; nothing is copied
+    auto wall = [this](int x, int y) {
+        return storage == storage_mode::compact ? current_maze.packed.is_wall(x, y) : current_maze.grid(x, y) == WALL;
+    };
     cell current_cell(1, 1); // Start at entrance
 
-    while (current_cell.x != height - 2 || current_cell.y != width - 2) { // Until exit
-        char c;
-        play_grid[current_cell.x][current_cell.y] = ' '; // Clear current position
+    // SIGWINCH only writes to a pipe; the loop picks the resize up from poll()
+    int resize_pipe[2] = {-1, -1};
+    struct sigaction resize_action, previous_action;
+    const bool watch_resize = pipe(resize_pipe) == 0;
+    if (watch_resize) {
+        for (int fd : resize_pipe)
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        resize_fd = resize_pipe[1];
+        resize_action = {};
+        resize_action.sa_handler = on_resize;
+        sigemptyset(&resize_action.sa_mask);
+        sigaction(SIGWINCH, &resize_action, &previous_action);
+    }
+
+    terminal_renderer screen(out_fd);
+    screen.query_size();
+    screen.begin();
+
+    typedef std::chrono::steady_clock clock;
+    const auto frame_interval = std::chrono::milliseconds(PLAY_FRAME_MS);
+    auto last_frame = clock::now() - frame_interval;
+    bool dirty = true; // The first frame is drawn right away
+    bool done = false;
+    key_decoder keys;
+    char buffer[256];
+
+    while (!done) {
+        int timeout = -1; // Idle: sleep until something happens
+        if (dirty) {
+            const auto due = last_frame + frame_interval;
+            const auto now = clock::now();
+            if (now >= due) {
+                screen.focus(current_cell.x, current_cell.y);
+                screen.draw(height, width, [&](int x, int y) {
+                    if (unsigned(x) == current_cell.x && unsigned(y) == current_cell.y)
+                        return PATH; // Highlight player
+                    return wall(x, y) ? WALL : CELL;
+                }, "Use WASD or arrow keys to move, Q to quit");
+                ++stats.frames;
+                last_frame = now;
+                dirty = false;
+            } else {
+                timeout = int(std::chrono::duration_cast<std::chrono::milliseconds>(due - now).count()) + 1;
+            }
+        }
+        if (!dirty && keys.waiting())
+            timeout = PLAY_ESCAPE_MS; // A lone ESC is given a moment to become an arrow key
+
+        pollfd fds[2] = {{in_fd, POLLIN, 0}, {watch_resize ? resize_pipe[0] : -1, POLLIN, 0}};
+        const int ready = poll(fds, 2, timeout);
+        if (ready < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        if (ready == 0) {
+            if (!dirty && keys.waiting())
+                keys.flush();
+            continue;
+        }
+
+        if (fds[1].revents & POLLIN) {
+            while (read(resize_pipe[0], buffer, sizeof(buffer)) > 0) {}
+            screen.query_size();
+            dirty = true;
+        }
+        if (fds[0].revents & (POLLIN | POLLHUP | POLLERR)) {
+            const ssize_t n = read(in_fd, buffer, sizeof(buffer));
+            if (n < 0 && (errno == EINTR || errno == EAGAIN))
+                continue;
+            if (n <= 0) {
+                done = true; // End of input
+                break;
+            }
+            keys.feed(buffer, size_t(n));
+        }
 
-        if (read(STDIN_FILENO, &c, 1) == 1) {
-            if (c == 'q') break; // Quit game
+        // Every key that arrived is applied, so a repeating key never falls behind the screen
+        play_key key;
+        while (!done && keys.next(key)) {
+            if (key == play_key::none)
+                continue;
+            ++stats.keys;
+            const unsigned x = current_cell.x, y = current_cell.y;
             // Move if no wall in the direction
-            else if (c == 'w' && play_grid[current_cell.x - 1][current_cell.y] != WALL && (current_cell.x != 1 || current_cell.y != 1))
+            if (key == play_key::quit)
+                done = true;
+            else if (key == play_key::up && !wall(x - 1, y) && (x != 1 || y != 1))
                 current_cell.x -= 2;
-            else if (c == 's' && play_grid[current_cell.x + 1][current_cell.y] != WALL)
+            else if (key == play_key::down && !wall(x + 1, y))
                 current_cell.x += 2;
-            else if (c == 'a' && play_grid[current_cell.x][current_cell.y - 1] != WALL)
+            else if (key == play_key::left && !wall(x, y - 1))
                 current_cell.y -= 2;
-            else if (c == 'd' && play_grid[current_cell.x][current_cell.y + 1] != WALL)
+            else if (key == play_key::right && !wall(x, y + 1))
                 current_cell.y += 2;
-        }
 
-        play_grid[current_cell.x][current_cell.y] = '*'; // Mark player position
-        driver_logic::clear_screen(); // Clear screen for redraw
-
-        std::stringstream ss;
-        for (const auto &row : play_grid) {
-            for (char cell : row)
-                if (cell == '*') {
-                    ss << RED << cell << RESET << CELL; // Highlight player
-                } else {
-                    ss << cell << CELL;
-                }
-            ss << std::endl;
+            if (current_cell.x != x || current_cell.y != y) {
+                ++stats.moves;
+                dirty = true;
+            }
+            if (current_cell.x == unsigned(height - 2) && current_cell.y == unsigned(width - 2)) { // Exit reached
+                stats.escaped = true;
+                done = true;
+            }
         }
-
-        std::cout << ss.str();
-        std::cout << "Use WASD to move, Q to quit" << std::endl;
-        std::cout << std::flush;
-
-        usleep(100000); // Small delay for smoother display
     }
 
-    // Restore original terminal settings
-    tcsetattr(STDIN_FILENO, TCSANOW, &original_attributes);
+    screen.end();
+    if (watch_resize) {
+        sigaction(SIGWINCH, &previous_action, nullptr);
+        resize_fd = -1;
+        close(resize_pipe[0]);
+        close(resize_pipe[1]);
+    }
+    stats.x = current_cell.x;
+    stats.y = current_cell.y;
+    return stats;
 }
 
 } 
\ No newline at end of file
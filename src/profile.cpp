@@ -0,0 +1,86 @@
+#include "maze.h"
+#include <atomic>
+#include <cstdio>
+
+namespace maze_gen {
+namespace profile {
+
+namespace {
+
+constexpr int PHASES = int(phase::count);
+constexpr int COUNTERS = int(counter::count);
+
+// Relaxed atomics: batch workers and tile threads add to the same totals
+std::atomic<uint64_t> phase_ns[PHASES];
+std::atomic<uint64_t> phase_calls[PHASES];
+std::atomic<uint64_t> counters[COUNTERS];
+
+}
+
+const char *phase_name(phase p) {
+    static const char *const names[PHASES] = {"grid_init", "carve", "unvisited_scan", "solve",
+                                              "save",      "load",  "print"};
+    return names[int(p)];
+}
+
+const char *counter_name(counter c) {
+    static const char *const names[COUNTERS] = {"cells_visited",  "backtracks",    "random_jumps",
+                                                "nodes_expanded", "bytes_written", "bytes_read"};
+    return names[int(c)];
+}
+
+void add_time(phase p, uint64_t ns) {
+    phase_ns[int(p)].fetch_add(ns, std::memory_order_relaxed);
+    phase_calls[int(p)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void add(counter c, uint64_t n) {
+    counters[int(c)].fetch_add(n, std::memory_order_relaxed);
+}
+
+void reset() {
+    for (int i = 0; i < PHASES; ++i) {
+        phase_ns[i] = 0;
+        phase_calls[i] = 0;
+    }
+    for (int i = 0; i < COUNTERS; ++i)
+        counters[i] = 0;
+}
+
+// Writes one line per phase and per counter.
+void write_text(std::ostream &out) {
+    if (!enabled) {
+        out << "Profiling is disabled; configure with -DMAZE_PROFILE=ON to record timers and counters" << std::endl;
+        return;
+    }
+    char line[80];
+    std::snprintf(line, sizeof(line), "%-16s %8s %15s", "phase", "calls", "total_ms");
+    out << line << std::endl;
+    for (int i = 0; i < PHASES; ++i) {
+        std::snprintf(line, sizeof(line), "%-16s %8llu %15.3f", phase_name(phase(i)),
+                      (unsigned long long)phase_calls[i].load(), phase_ns[i].load() / 1e6);
+        out << line << std::endl;
+    }
+    std::snprintf(line, sizeof(line), "%-16s %15s", "counter", "total");
+    out << line << std::endl;
+    for (int i = 0; i < COUNTERS; ++i) {
+        std::snprintf(line, sizeof(line), "%-16s %15llu", counter_name(counter(i)),
+                      (unsigned long long)counters[i].load());
+        out << line << std::endl;
+    }
+}
+
+// Writes the report as a single JSON object on one line.
+void write_json(std::ostream &out) {
+    out << "{\"enabled\":" << (enabled ? "true" : "false") << ",\"phases\":{";
+    for (int i = 0; i < PHASES; ++i)
+        out << (i ? "," : "") << '"' << phase_name(phase(i)) << "\":{\"calls\":" << phase_calls[i].load()
+            << ",\"ms\":" << phase_ns[i].load() / 1e6 << '}';
+    out << "},\"counters\":{";
+    for (int i = 0; i < COUNTERS; ++i)
+        out << (i ? "," : "") << '"' << counter_name(counter(i)) << "\":" << counters[i].load();
+    out << "}}" << std::endl;
+}
+
+}
+}
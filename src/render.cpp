@@ -0,0 +1,159 @@
+#include "maze.h"
+#include <cerrno>
+#include <sys/ioctl.h>
+
+namespace maze_gen {
+
+namespace {
+
+void append_int(std::string &out, int v) {
+    char digits[12];
+    int n = 0;
+    do {
+        digits[n++] = char('0' + v % 10);
+        v /= 10;
+    } while (v > 0);
+    while (n > 0)
+        out += digits[--n];
+}
+
+// Cursor move to a 1-based terminal row and column.
+void append_move(std::string &out, int row, int col) {
+    out += "\033[";
+    append_int(out, row);
+    out += ';';
+    append_int(out, col);
+    out += 'H';
+}
+
+}
+
+terminal_renderer::terminal_renderer(int fd)
+    : fd_(fd), screen_rows_(24), screen_cols_(80), view_rows_(0), view_cols_(0), top_(0), left_(0), focus_x_(0),
+      focus_y_(0), clear_(true), bytes_written_(0) {
+}
+
+void terminal_renderer::begin() {
+    out_ = "\033[?1049h\033[?25l";
+    flush();
+    invalidate();
+}
+
+void terminal_renderer::end() {
+    out_ = "\033[0m\033[?25h\033[?1049l";
+    flush();
+}
+
+void terminal_renderer::query_size() {
+    winsize ws;
+    if (ioctl(fd_, TIOCGWINSZ, &ws) == 0 && ws.ws_row > 0 && ws.ws_col > 0)
+        resize(ws.ws_row, ws.ws_col);
+}
+
+// Sets the terminal size in character cells; a change redraws the next frame in full.
+void terminal_renderer::resize(int rows, int cols) {
+    if (rows == screen_rows_ && cols == screen_cols_)
+        return;
+    screen_rows_ = rows;
+    screen_cols_ = cols;
+    invalidate();
+}
+
+// Grid position the viewport keeps in view, such as the player.
+void terminal_renderer::focus(int x, int y) {
+    focus_x_ = x;
+    focus_y_ = y;
+}
+
+void terminal_renderer::invalidate() {
+    view_rows_ = view_cols_ = 0; // Forces layout() to size the buffers again
+    clear_ = true;
+}
+
+/*
+Sizes the viewport for a maze and scrolls it so the focus stays at least a quarter
+of the viewport away from its edges, where the maze allows.
+ */
+void terminal_renderer::layout(int height, int width) {
+    const int rows = std::max(1, std::min(height, screen_rows_ - 1)); // Last line holds the status
+    const int cols = std::max(1, std::min(width, screen_cols_ / 2));
+    if (rows != view_rows_ || cols != view_cols_) {
+        view_rows_ = rows;
+        view_cols_ = cols;
+        back_.assign(size_t(rows) * cols, 0);
+        front_.assign(size_t(rows) * cols, 0);
+        out_.reserve(size_t(rows) * cols * 12);
+        clear_ = true;
+    }
+
+    auto scroll = [](int origin, int focus, int view, int size) {
+        const int margin = view / 4;
+        if (focus < origin + margin)
+            origin = focus - margin;
+        else if (focus >= origin + view - margin)
+            origin = focus - view + margin + 1;
+        return std::max(0, std::min(origin, size - view));
+    };
+    top_ = scroll(top_, focus_x_, view_rows_, height);
+    left_ = scroll(left_, focus_y_, view_cols_, width);
+}
+
+// Emits the cells that differ from the screen, run by run, then the status line.
+void terminal_renderer::present() {
+    out_.clear();
+    if (clear_) {
+        out_ += "\033[0m\033[2J";
+        std::fill(front_.begin(), front_.end(), 0);
+        shown_status_.assign(1, '\0'); // Never equal to a real status
+        clear_ = false;
+    }
+
+    bool red = false;
+    for (int i = 0; i < view_rows_; ++i) {
+        const char *back = &back_[size_t(i) * view_cols_];
+        char *front = &front_[size_t(i) * view_cols_];
+        for (int j = 0; j < view_cols_;) {
+            if (back[j] == front[j]) {
+                ++j;
+                continue;
+            }
+            append_move(out_, i + 1, 2 * j + 1);
+            for (; j < view_cols_ && back[j] != front[j]; ++j) {
+                if ((back[j] == PATH) != red) {
+                    red = !red;
+                    out_ += red ? RED : RESET;
+                }
+                out_ += back[j];
+                out_ += CELL;
+                front[j] = back[j];
+            }
+        }
+    }
+    if (red)
+        out_ += RESET;
+
+    if (status_ != shown_status_) {
+        append_move(out_, view_rows_ + 1, 1);
+        out_ += status_;
+        out_ += "\033[K";
+        shown_status_ = status_;
+    }
+    flush();
+}
+
+// Writes the frame buffer with as few write() calls as the descriptor allows.
+void terminal_renderer::flush() {
+    size_t done = 0;
+    while (done < out_.size()) {
+        ssize_t n = write(fd_, out_.data() + done, out_.size() - done);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        done += size_t(n);
+    }
+    bytes_written_ += done;
+    out_.clear();
+}
+
+}
@@ -0,0 +1,425 @@
+#include "maze.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+namespace maze_gen {
+
+namespace {
+
+constexpr int POLL_MS = 200;         // How often an idle connection checks for stop()
+constexpr size_t MAX_LINE = 1024;    // Longest request line
+constexpr size_t SEND_CHUNK = 65536; // Response bytes buffered before a send
+
+// Buffers a response and sends it in chunks, so large mazes never sit in memory as text.
+class fd_writer {
+    int fd_;
+    std::string buffer_;
+    bool ok_;
+
+public:
+    explicit fd_writer(int fd) : fd_(fd), ok_(true) { buffer_.reserve(SEND_CHUNK); }
+
+    void put(const char *data, size_t n) {
+        buffer_.append(data, n);
+        if (buffer_.size() >= SEND_CHUNK)
+            flush();
+    }
+    void put(const std::string &s) { put(s.data(), s.size()); }
+
+    bool flush() {
+        for (size_t sent = 0; ok_ && sent < buffer_.size();) {
+            const ssize_t n = send(fd_, buffer_.data() + sent, buffer_.size() - sent, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR)
+                continue;
+            ok_ = n > 0;
+            sent += ok_ ? size_t(n) : 0;
+        }
+        buffer_.clear();
+        return ok_;
+    }
+    bool ok() const { return ok_; }
+};
+
+/*
+Reads the size, algorithm and seed that start GENERATE, SOLVE and REGION requests.
+return False with a message if any is missing or invalid.
+ */
+bool parse_key(std::istringstream &in, size_t max_positions, maze_key &key, std::string &error) {
+    std::string algo;
+    if (!(in >> key.width >> key.height >> algo >> key.seed)) {
+        error = "expected width height algo seed";
+        return false;
+    }
+    if (key.width % 2 == 0 || key.width <= 3 || key.height % 2 == 0 || key.height <= 3) {
+        error = "width and height must be odd numbers greater than 3";
+        return false;
+    }
+    if (size_t(key.width) * size_t(key.height) > max_positions) {
+        error = "maze is larger than the server allows";
+        return false;
+    }
+    if (!parse_algorithm(algo, key.algo)) {
+        error = "unknown algorithm " + algo;
+        return false;
+    }
+    return true;
+}
+
+}
+
+size_t maze_key_hash::operator()(const maze_key &k) const {
+    const uint64_t shape = (uint64_t(uint32_t(k.width)) << 32 | uint32_t(k.height)) * 31 + uint64_t(k.algo);
+    return size_t(mix_seed(k.seed, shape));
+}
+
+maze_cache::maze_cache(size_t budget_bytes) : budget_(budget_bytes) {
+    stats_.budget = budget_bytes;
+}
+
+// Drops least recently used entries until the cache fits its budget. Called with lock_ held.
+void maze_cache::evict() {
+    while (stats_.bytes > budget_ && !order_.empty()) {
+        auto it = slots_.find(order_.back().first);
+        stats_.bytes -= it->second.bytes;
+        slots_.erase(it);
+        order_.pop_back();
+        ++stats_.evictions;
+    }
+    stats_.entries = slots_.size();
+}
+
+std::shared_ptr<cached_maze> maze_cache::find(const maze_key &key) {
+    std::lock_guard<std::mutex> guard(lock_);
+    auto it = slots_.find(key);
+    if (it == slots_.end()) {
+        ++stats_.misses;
+        return nullptr;
+    }
+    ++stats_.hits;
+    order_.splice(order_.begin(), order_, it->second.at);
+    return it->second.at->second;
+}
+
+std::shared_ptr<cached_maze> maze_cache::insert(const maze_key &key, std::shared_ptr<cached_maze> entry) {
+    const size_t bytes = entry->bytes();
+    if (bytes > budget_)
+        return entry;
+    std::lock_guard<std::mutex> guard(lock_);
+    auto it = slots_.find(key);
+    if (it != slots_.end()) {
+        order_.splice(order_.begin(), order_, it->second.at);
+        return it->second.at->second;
+    }
+    order_.emplace_front(key, entry);
+    slots_[key] = slot{order_.begin(), bytes};
+    stats_.bytes += bytes;
+    evict();
+    return entry;
+}
+
+void maze_cache::update(const maze_key &key, const cached_maze &entry) {
+    const size_t bytes = entry.bytes();
+    std::lock_guard<std::mutex> guard(lock_);
+    auto it = slots_.find(key);
+    if (it == slots_.end() || it->second.at->second.get() != &entry)
+        return; // Evicted meanwhile, or replaced by another copy of the maze
+    stats_.bytes += bytes - it->second.bytes;
+    it->second.bytes = bytes;
+    if (bytes > budget_) {
+        stats_.bytes -= bytes;
+        order_.erase(it->second.at);
+        slots_.erase(it);
+        ++stats_.evictions;
+    }
+    evict();
+}
+
+cache_stats maze_cache::stats() const {
+    std::lock_guard<std::mutex> guard(lock_);
+    return stats_;
+}
+
+maze_server::maze_server(const server_options &options)
+    : options_(options), cache_(options.cache_bytes), listen_fd_(-1), wake_{-1, -1}, stopping_(false) {
+    if (options_.workers < 1)
+        options_.workers = int(std::max(1u, std::thread::hardware_concurrency()));
+}
+
+maze_server::~maze_server() {
+    if (listen_fd_ >= 0)
+        close(listen_fd_);
+    for (int fd : wake_)
+        if (fd >= 0)
+            close(fd);
+}
+
+/*
+Creates the listening socket.
+param path File system path of the socket; an existing socket file there is replaced.
+param error Receives a message on failure.
+return True if the server is ready for run().
+ */
+bool maze_server::listen(const std::string &path, std::string &error) {
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+        error = "socket path must be 1 to " + std::to_string(sizeof(addr.sun_path) - 1) + " characters";
+        return false;
+    }
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+    if (pipe(wake_) != 0) {
+        error = std::string("pipe: ") + std::strerror(errno);
+        return false;
+    }
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) {
+        error = std::string("socket: ") + std::strerror(errno);
+        return false;
+    }
+    unlink(path.c_str());
+    if (bind(listen_fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 ||
+        ::listen(listen_fd_, SOMAXCONN) != 0) {
+        error = path + ": " + std::strerror(errno);
+        close(listen_fd_);
+        listen_fd_ = -1;
+        return false;
+    }
+    path_ = path;
+    return true;
+}
+
+void maze_server::stop() {
+    stopping_ = true;
+    if (wake_[1] >= 0) {
+        const char byte = 0;
+        (void)!write(wake_[1], &byte, 1);
+    }
+}
+
+/*
+Accepts connections and queues them for the workers until stop() is called,
+then lets the workers finish the requests they are on and closes the socket.
+ */
+void maze_server::run() {
+    if (listen_fd_ < 0)
+        return;
+    std::vector<std::thread> pool;
+    for (int i = 0; i < options_.workers; ++i)
+        pool.emplace_back(&maze_server::serve, this);
+
+    pollfd fds[2] = {{listen_fd_, POLLIN, 0}, {wake_[0], POLLIN, 0}};
+    while (!stopping_) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        if (fds[1].revents)
+            break;
+        if (fds[0].revents & POLLIN) {
+            const int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd < 0)
+                continue;
+            std::lock_guard<std::mutex> guard(queue_lock_);
+            pending_.push_back(fd);
+            queue_ready_.notify_one();
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(queue_lock_);
+        stopping_ = true;
+        queue_ready_.notify_all();
+    }
+    for (std::thread &th : pool)
+        th.join();
+    for (int fd : pending_)
+        close(fd);
+    pending_.clear();
+    close(listen_fd_);
+    listen_fd_ = -1;
+    unlink(path_.c_str());
+}
+
+// Worker loop: takes queued connections one at a time with a generator whose buffers carry over.
+void maze_server::serve() {
+    maze_generator generator;
+    generator.set_verbose(false);
+    generator.set_storage(options_.storage);
+    generator.set_threads(1); // Parallelism comes from the workers
+    for (;;) {
+        int fd;
+        {
+            std::unique_lock<std::mutex> guard(queue_lock_);
+            queue_ready_.wait(guard, [this] { return stopping_ || !pending_.empty(); });
+            if (stopping_)
+                return;
+            fd = pending_.front();
+            pending_.pop_front();
+        }
+        handle(fd, generator);
+        close(fd);
+    }
+}
+
+/*
+Looks a maze up in the cache, generating and caching it on a miss.
+param hit Set to whether the cache had the maze.
+return The maze, shared with the cache.
+ */
+std::shared_ptr<cached_maze> maze_server::fetch(const maze_key &key, maze_generator &generator, bool &hit) {
+    std::shared_ptr<cached_maze> entry = cache_.find(key);
+    hit = bool(entry);
+    if (hit)
+        return entry;
+
+    generator.set_size(key.width, key.height);
+    generator.set_algorithm(key.algo);
+    generator.set_seed(key.seed);
+    generator.generate_maze();
+    entry = std::make_shared<cached_maze>();
+    const maze &built = generator.get_maze();
+    if (options_.storage == storage_mode::compact) {
+        entry->walls = built.packed;
+    } else {
+        entry->walls.assign(built.height, built.width);
+        for (int x = 0; x < built.height; ++x)
+            entry->walls.pack_row(x, built.grid.row(x));
+    }
+    return cache_.insert(key, entry);
+}
+
+/*
+Answers the requests of one connection until the client closes it, sends QUIT,
+stays idle for options_.idle_ms or the server stops.
+ */
+void maze_server::handle(int fd, maze_generator &generator) {
+    fd_writer out(fd);
+    std::string pending;
+    char buffer[4096];
+    int idle = 0;
+    std::vector<char> row;
+
+    while (out.ok() && !stopping_) {
+        size_t eol = pending.find('\n');
+        if (eol == std::string::npos) {
+            if (pending.size() > MAX_LINE) {
+                out.put("ERR request line too long\n");
+                out.flush();
+                return;
+            }
+            pollfd p = {fd, POLLIN, 0};
+            const int ready = poll(&p, 1, POLL_MS);
+            if (ready < 0 && errno != EINTR)
+                return;
+            if (ready <= 0) {
+                idle += POLL_MS;
+                if (idle >= options_.idle_ms)
+                    return;
+                continue;
+            }
+            const ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return;
+            pending.append(buffer, size_t(n));
+            idle = 0;
+            continue;
+        }
+
+        std::istringstream in(pending.substr(0, eol));
+        pending.erase(0, eol + 1);
+        std::string command, error;
+        in >> command;
+        if (command.empty())
+            continue;
+        if (command == "QUIT") {
+            out.flush();
+            return;
+        }
+        if (command == "STATS") {
+            std::ostringstream json;
+            write_json(json, cache_.stats());
+            out.put("OK " + json.str() + "\n");
+            out.flush();
+            continue;
+        }
+        if (command != "GENERATE" && command != "SOLVE" && command != "REGION") {
+            out.put("ERR unknown command " + command + "\n");
+            out.flush();
+            continue;
+        }
+
+        maze_key key;
+        int top = 0, left = 0, rows = 0, cols = 0;
+        if (parse_key(in, options_.max_positions, key, error) && command == "REGION" &&
+            !(in >> top >> left >> rows >> cols))
+            error = "expected top left rows cols";
+        if (!error.empty()) {
+            out.put("ERR " + error + "\n");
+            out.flush();
+            continue;
+        }
+
+        bool hit;
+        std::shared_ptr<cached_maze> entry = fetch(key, generator, hit);
+        const compact_walls &walls = entry->walls;
+        const compact_walls *path = nullptr;
+        if (command == "SOLVE") {
+            // The first client to ask solves the maze; the cache is charged for the overlay once
+            bool solved_here = false;
+            {
+                std::lock_guard<std::mutex> guard(entry->solve_lock);
+                if (!entry->solved) {
+                    solve_result res = find_path(walls, solver_algorithm::bfs, cell(1, 1),
+                                                 cell(key.height - 2, key.width - 2));
+                    entry->path.assign(key.height, key.width);
+                    trace_path(res.path, entry->path);
+                    entry->path_cells = res.path.size();
+                    entry->solved = solved_here = true;
+                }
+            }
+            if (solved_here)
+                cache_.update(key, *entry);
+            path = &entry->path;
+        }
+
+        // The whole maze unless a region was asked for, clipped as inspect() does
+        if (command == "REGION") {
+            top = std::min(std::max(top, 0) & ~1, key.height - 3);
+            left = std::min(std::max(left, 0) & ~1, key.width - 3);
+            rows = std::min(std::max(rows, 3) | 1, key.height - top);
+            cols = std::min(std::max(cols, 3) | 1, key.width - left);
+        } else {
+            rows = key.height;
+            cols = key.width;
+        }
+        out.put("OK " + std::to_string(rows) + " " + std::to_string(cols) + (hit ? " hit\n" : " miss\n"));
+        row.resize(size_t(key.width) + 1);
+        for (int x = top; x < top + rows; ++x) {
+            walls.expand_row(x, row.data());
+            if (path)
+                mark_path_row(*path, x, row.data());
+            row[size_t(left + cols)] = '\n';
+            out.put(row.data() + left, size_t(cols) + 1);
+        }
+        out.flush();
+    }
+}
+
+// Writes the cache counters as one JSON object.
+void write_json(std::ostream &out, const cache_stats &stats) {
+    const size_t lookups = stats.hits + stats.misses;
+    out << "{\"hits\":" << stats.hits << ",\"misses\":" << stats.misses
+        << ",\"hit_rate\":" << (lookups ? double(stats.hits) / lookups : 0.0) << ",\"evictions\":" << stats.evictions
+        << ",\"entries\":" << stats.entries << ",\"bytes\":" << stats.bytes << ",\"budget\":" << stats.budget << "}";
+}
+
+}
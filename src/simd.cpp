@@ -0,0 +1,257 @@
+#include "maze.h"
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define MAZE_SIMD_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MAZE_SIMD_SSE2 1
+#endif
+
+namespace maze_gen {
+namespace simd {
+
+namespace {
+
+const size_t RED_SIZE = sizeof(RED) - 1;
+const size_t RESET_SIZE = sizeof(RESET) - 1;
+
+#if defined(MAZE_SIMD_AVX2) || defined(MAZE_SIMD_SSE2)
+inline int lowest_bit(unsigned v) {
+#if defined(__GNUC__)
+    return __builtin_ctz(v);
+#else
+    int n = 0;
+    while (!(v & 1)) {
+        v >>= 1;
+        ++n;
+    }
+    return n;
+#endif
+}
+#endif
+
+// One position of the text form; highlighted PATH positions take the escape codes around them.
+inline char *put_text(char *out, char c, bool highlight) {
+    if (highlight && c == PATH) {
+        std::memcpy(out, RED, RED_SIZE);
+        out += RED_SIZE;
+        *out++ = c;
+        std::memcpy(out, RESET, RESET_SIZE);
+        out += RESET_SIZE;
+    } else {
+        *out++ = c;
+    }
+    *out++ = CELL;
+    return out;
+}
+
+}
+
+namespace scalar {
+
+void fill_lattice_row(char *row, int width) {
+    for (int j = 0; j < width; ++j)
+        row[j] = j % 2 ? CELL : WALL;
+}
+
+size_t count_unvisited_row(const unsigned char *row, int end) {
+    size_t n = 0;
+    for (int j = 1; j < end; j += 2)
+        n += row[j] == 0;
+    return n;
+}
+
+int next_unvisited_in_row(const unsigned char *row, int from, int end) {
+    for (int j = from | 1; j < end; j += 2)
+        if (row[j] == 0)
+            return j;
+    return end;
+}
+
+size_t expand_text_row(const char *row, int width, char *out, bool highlight) {
+    char *p = out;
+    for (int j = 0; j < width; ++j)
+        p = put_text(p, row[j], highlight);
+    return size_t(p - out);
+}
+
+}
+
+size_t text_row_capacity(int width) {
+    return size_t(width) * (2 + RED_SIZE + RESET_SIZE);
+}
+
+#if defined(MAZE_SIMD_AVX2)
+
+const char *level() {
+    return "avx2";
+}
+
+void fill_lattice_row(char *row, int width) {
+    const __m256i lattice = _mm256_set1_epi16(short((CELL << 8) | WALL)); // WALL at even bytes
+    int j = 0;
+    for (; j + 32 <= width; j += 32)
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(row + j), lattice);
+    scalar::fill_lattice_row(row + j, width - j); // j is even, so the pattern continues
+}
+
+size_t count_unvisited_row(const unsigned char *row, int end) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i odd = _mm256_set1_epi16(short(0xFF00));
+    __m256i total = zero, counts = zero; // Per-byte hit counts, folded into total before they can wrap
+    int j = 0, batch = 0;
+    for (; j + 32 <= end; j += 32) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row + j));
+        counts = _mm256_sub_epi8(counts, _mm256_and_si256(_mm256_cmpeq_epi8(v, zero), odd));
+        if (++batch == 255) {
+            total = _mm256_add_epi64(total, _mm256_sad_epu8(counts, zero));
+            counts = zero;
+            batch = 0;
+        }
+    }
+    total = _mm256_add_epi64(total, _mm256_sad_epu8(counts, zero));
+    uint64_t lanes[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes), total);
+    size_t n = size_t(lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+    for (j |= 1; j < end; j += 2)
+        n += row[j] == 0;
+    return n;
+}
+
+int next_unvisited_in_row(const unsigned char *row, int from, int end) {
+    const __m256i zero = _mm256_setzero_si256();
+    int j = from | 1;
+    for (; j < end && j % 32 != 1; j += 2) // Up to the next 32-byte boundary
+        if (row[j] == 0)
+            return j;
+    for (j -= 1; j + 32 <= end; j += 32) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row + j));
+        const unsigned hits = unsigned(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, zero))) & 0xAAAAAAAAu;
+        if (hits)
+            return j + lowest_bit(hits);
+    }
+    return scalar::next_unvisited_in_row(row, j, end);
+}
+
+size_t expand_text_row(const char *row, int width, char *out, bool highlight) {
+    const __m256i spaces = _mm256_set1_epi8(CELL);
+    const __m256i path = _mm256_set1_epi8(PATH);
+    char *p = out;
+    int j = 0;
+    for (; j + 32 <= width; j += 32) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row + j));
+        if (highlight && _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, path))) {
+            for (int k = 0; k < 32; ++k)
+                p = put_text(p, row[j + k], true);
+            continue;
+        }
+        // Unpacking works within 128-bit lanes; the permutes put the halves back in order
+        const __m256i lo = _mm256_unpacklo_epi8(v, spaces), hi = _mm256_unpackhi_epi8(v, spaces);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(p + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+        p += 64;
+    }
+    p += scalar::expand_text_row(row + j, width - j, p, highlight);
+    return size_t(p - out);
+}
+
+#elif defined(MAZE_SIMD_SSE2)
+
+const char *level() {
+    return "sse2";
+}
+
+void fill_lattice_row(char *row, int width) {
+    const __m128i lattice = _mm_set1_epi16(short((CELL << 8) | WALL)); // WALL at even bytes
+    int j = 0;
+    for (; j + 16 <= width; j += 16)
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(row + j), lattice);
+    scalar::fill_lattice_row(row + j, width - j); // j is even, so the pattern continues
+}
+
+size_t count_unvisited_row(const unsigned char *row, int end) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i odd = _mm_set1_epi16(short(0xFF00));
+    __m128i total = zero, counts = zero; // Per-byte hit counts, folded into total before they can wrap
+    int j = 0, batch = 0;
+    for (; j + 16 <= end; j += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + j));
+        counts = _mm_sub_epi8(counts, _mm_and_si128(_mm_cmpeq_epi8(v, zero), odd));
+        if (++batch == 255) {
+            total = _mm_add_epi64(total, _mm_sad_epu8(counts, zero));
+            counts = zero;
+            batch = 0;
+        }
+    }
+    total = _mm_add_epi64(total, _mm_sad_epu8(counts, zero));
+    uint64_t lanes[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes), total);
+    size_t n = size_t(lanes[0] + lanes[1]);
+    for (j |= 1; j < end; j += 2)
+        n += row[j] == 0;
+    return n;
+}
+
+int next_unvisited_in_row(const unsigned char *row, int from, int end) {
+    const __m128i zero = _mm_setzero_si128();
+    int j = from | 1;
+    for (; j < end && j % 16 != 1; j += 2) // Up to the next 16-byte boundary
+        if (row[j] == 0)
+            return j;
+    for (j -= 1; j + 16 <= end; j += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + j));
+        const unsigned hits = unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero))) & 0xAAAAu;
+        if (hits)
+            return j + lowest_bit(hits);
+    }
+    return scalar::next_unvisited_in_row(row, j, end);
+}
+
+size_t expand_text_row(const char *row, int width, char *out, bool highlight) {
+    const __m128i spaces = _mm_set1_epi8(CELL);
+    const __m128i path = _mm_set1_epi8(PATH);
+    char *p = out;
+    int j = 0;
+    for (; j + 16 <= width; j += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + j));
+        if (highlight && _mm_movemask_epi8(_mm_cmpeq_epi8(v, path))) {
+            for (int k = 0; k < 16; ++k)
+                p = put_text(p, row[j + k], true);
+            continue;
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(p), _mm_unpacklo_epi8(v, spaces));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(p + 16), _mm_unpackhi_epi8(v, spaces));
+        p += 32;
+    }
+    p += scalar::expand_text_row(row + j, width - j, p, highlight);
+    return size_t(p - out);
+}
+
+#else
+
+const char *level() {
+    return "scalar";
+}
+
+void fill_lattice_row(char *row, int width) {
+    scalar::fill_lattice_row(row, width);
+}
+
+size_t count_unvisited_row(const unsigned char *row, int end) {
+    return scalar::count_unvisited_row(row, end);
+}
+
+int next_unvisited_in_row(const unsigned char *row, int from, int end) {
+    return scalar::next_unvisited_in_row(row, from, end);
+}
+
+size_t expand_text_row(const char *row, int width, char *out, bool highlight) {
+    return scalar::expand_text_row(row, width, out, highlight);
+}
+
+#endif
+
+}
+}
@@ -0,0 +1,382 @@
+#include "maze.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <queue>
+#include <thread>
+#include <cstdlib>
+
+namespace maze_gen {
+
+bool grid_view::is_wall(int x, int y) const {
+    return (*grid_)(x, y) == WALL;
+}
+
+// Returns the command-line name of a solver algorithm.
+const char *solver_name(solver_algorithm algo) {
+    switch (algo) {
+    case solver_algorithm::bfs: return "bfs";
+    case solver_algorithm::astar: return "astar";
+    case solver_algorithm::bidirectional: return "bidirectional";
+    case solver_algorithm::dfs: return "dfs";
+    case solver_algorithm::parallel: return "parallel";
+    }
+    return "unknown";
+}
+
+/*
+Looks up a solver algorithm by its name.
+param name One of bfs, astar, bidirectional, dfs, parallel.
+param algo Set to the matching algorithm.
+return True if the name is known.
+ */
+bool parse_solver(const std::string &name, solver_algorithm &algo) {
+    for (solver_algorithm a : {solver_algorithm::bfs, solver_algorithm::astar, solver_algorithm::bidirectional,
+                               solver_algorithm::dfs, solver_algorithm::parallel})
+        if (name == solver_name(a)) {
+            algo = a;
+            return true;
+        }
+    return false;
+}
+
+namespace {
+
+// Logical cell (r, c), found at grid position (2r + 1, 2c + 1).
+struct node {
+    int r, c;
+};
+
+// Logical cell graph over a grid-position view.
+template <typename View>
+struct cell_graph {
+    const View &maze;
+    int rows, cols;
+
+    explicit cell_graph(const View &m) : maze(m), rows((m.height() - 1) / 2), cols((m.width() - 1) / 2) {}
+
+    // True if the cell in direction d from (r, c) exists and no wall separates them.
+    bool open(int r, int c, int d) const {
+        int nr = r + dir_row[d], nc = c + dir_col[d];
+        return nr >= 0 && nr < rows && nc >= 0 && nc < cols &&
+               !maze.is_wall(2 * r + 1 + dir_row[d], 2 * c + 1 + dir_col[d]);
+    }
+};
+
+// Appends (r, c) and every cell on the way back to (r0, c0), following the parent directions.
+template <typename Plane>
+void trace(const Plane &parent, int r, int c, int r0, int c0, std::vector<cell> &out) {
+    out.emplace_back(2 * r + 1, 2 * c + 1);
+    while (r != r0 || c != c0) {
+        int d = parent.get(r, c);
+        r += dir_row[d];
+        c += dir_col[d];
+        out.emplace_back(2 * r + 1, 2 * c + 1);
+    }
+}
+
+/*
+ Level-by-level breadth-first search. Only the current and next frontier are held,
+ and each cell costs one visited bit plus a 2-bit parent direction.
+ */
+template <typename View>
+void search_bfs(const cell_graph<View> &g, node start, node goal, solve_result &res) {
+    bit_plane seen, parent;
+    seen.assign(g.rows, g.cols, 1);
+    parent.assign(g.rows, g.cols, 2);
+
+    std::vector<node> frontier(1, start), next;
+    seen.set_bits(start.r, start.c, 1);
+
+    while (!frontier.empty()) {
+        for (node n : frontier) {
+            ++res.stats.nodes_expanded;
+            if (n.r == goal.r && n.c == goal.c) {
+                trace(parent, goal.r, goal.c, start.r, start.c, res.path);
+                std::reverse(res.path.begin(), res.path.end());
+                res.found = true;
+                return;
+            }
+            for (int d = 0; d < 4; ++d) {
+                if (!g.open(n.r, n.c, d))
+                    continue;
+                int nr = n.r + dir_row[d], nc = n.c + dir_col[d];
+                if (seen.get(nr, nc))
+                    continue;
+                seen.set_bits(nr, nc, 1);
+                parent.set(nr, nc, d ^ 2);
+                next.push_back({nr, nc});
+            }
+        }
+        frontier.swap(next);
+        next.clear();
+    }
+}
+
+struct open_entry {
+    unsigned f, g;        // Estimated total cost and cost so far
+    int r, c;
+    unsigned char from;   // Direction back to the predecessor, 4 for the start
+
+    // Orders the heap by lowest f, preferring deeper entries on ties
+    bool operator>(const open_entry &o) const { return f != o.f ? f > o.f : g < o.g; }
+};
+
+// A* search with the Manhattan distance to the goal as heuristic.
+template <typename View>
+void search_astar(const cell_graph<View> &g, node start, node goal, solve_result &res) {
+    bit_plane closed, parent;
+    closed.assign(g.rows, g.cols, 1);
+    parent.assign(g.rows, g.cols, 2);
+
+    auto h = [&](int r, int c) { return unsigned(std::abs(r - goal.r) + std::abs(c - goal.c)); };
+
+    std::priority_queue<open_entry, std::vector<open_entry>, std::greater<open_entry>> open;
+    open.push({h(start.r, start.c), 0, start.r, start.c, 4});
+
+    while (!open.empty()) {
+        open_entry e = open.top();
+        open.pop();
+        if (closed.get(e.r, e.c))
+            continue;
+        closed.set_bits(e.r, e.c, 1);
+        if (e.from < 4)
+            parent.set(e.r, e.c, e.from);
+        ++res.stats.nodes_expanded;
+
+        if (e.r == goal.r && e.c == goal.c) {
+            trace(parent, goal.r, goal.c, start.r, start.c, res.path);
+            std::reverse(res.path.begin(), res.path.end());
+            res.found = true;
+            return;
+        }
+        for (int d = 0; d < 4; ++d) {
+            if (!g.open(e.r, e.c, d))
+                continue;
+            int nr = e.r + dir_row[d], nc = e.c + dir_col[d];
+            if (!closed.get(nr, nc))
+                open.push({e.g + 1 + h(nr, nc), e.g + 1, nr, nc, (unsigned char)(d ^ 2)});
+        }
+    }
+}
+
+/*
+ Breadth-first search from both ends, always advancing the smaller frontier by one level.
+ Stops as soon as the two searches touch and joins their parent chains at that cell.
+ */
+template <typename View>
+void search_bidirectional(const cell_graph<View> &g, node start, node goal, solve_result &res) {
+    bit_plane seen[2], parent[2];
+    std::vector<node> frontier[2], next;
+    const node ends[2] = {start, goal};
+    for (int side = 0; side < 2; ++side) {
+        seen[side].assign(g.rows, g.cols, 1);
+        parent[side].assign(g.rows, g.cols, 2);
+        seen[side].set_bits(ends[side].r, ends[side].c, 1);
+        frontier[side].push_back(ends[side]);
+    }
+
+    if (start.r == goal.r && start.c == goal.c) {
+        res.path.emplace_back(2 * start.r + 1, 2 * start.c + 1);
+        res.found = true;
+        return;
+    }
+
+    while (!frontier[0].empty() && !frontier[1].empty()) {
+        const int side = frontier[0].size() <= frontier[1].size() ? 0 : 1;
+        for (node n : frontier[side]) {
+            ++res.stats.nodes_expanded;
+            for (int d = 0; d < 4; ++d) {
+                if (!g.open(n.r, n.c, d))
+                    continue;
+                int nr = n.r + dir_row[d], nc = n.c + dir_col[d];
+                if (seen[side].get(nr, nc))
+                    continue;
+                seen[side].set_bits(nr, nc, 1);
+                parent[side].set(nr, nc, d ^ 2);
+                if (seen[side ^ 1].get(nr, nc)) {
+                    // Meeting cell: start half reversed, then the goal half without repeating it
+                    trace(parent[0], nr, nc, start.r, start.c, res.path);
+                    std::reverse(res.path.begin(), res.path.end());
+                    std::vector<cell> rest;
+                    trace(parent[1], nr, nc, goal.r, goal.c, rest);
+                    res.path.insert(res.path.end(), rest.begin() + 1, rest.end());
+                    res.found = true;
+                    return;
+                }
+                next.push_back({nr, nc});
+            }
+        }
+        frontier[side].swap(next);
+        next.clear();
+    }
+}
+
+// Depth-first search taking the first open direction; finds a path, not necessarily the shortest.
+template <typename View>
+void search_dfs(const cell_graph<View> &g, node start, node goal, solve_result &res) {
+    bit_plane seen, parent;
+    seen.assign(g.rows, g.cols, 1);
+    parent.assign(g.rows, g.cols, 2);
+
+    int r = start.r, c = start.c;
+    seen.set_bits(r, c, 1);
+    ++res.stats.nodes_expanded;
+
+    while (r != goal.r || c != goal.c) {
+        int d = 0;
+        while (d < 4 && !(g.open(r, c, d) && !seen.get(r + dir_row[d], c + dir_col[d])))
+            ++d;
+        if (d < 4) {
+            r += dir_row[d];
+            c += dir_col[d];
+            parent.set(r, c, d ^ 2);
+            seen.set_bits(r, c, 1);
+            ++res.stats.nodes_expanded;
+        } else if (r != start.r || c != start.c) {
+            d = parent.get(r, c); // Backtrack
+            r += dir_row[d];
+            c += dir_col[d];
+        } else {
+            return; // Every reachable cell explored
+        }
+    }
+    trace(parent, goal.r, goal.c, start.r, start.c, res.path);
+    std::reverse(res.path.begin(), res.path.end());
+    res.found = true;
+}
+
+/*
+ Visited marks of the parallel search, 4 bits per cell: bit 2 is set once the
+ cell is reached and bits 0-1 hold the direction back to its parent. A cell is
+ claimed with a single compare-and-swap, so exactly one thread writes its parent.
+ */
+class claim_plane {
+    std::unique_ptr<std::atomic<uint64_t>[]> words_;
+    size_t cols_;
+
+  public:
+    claim_plane(int rows, int cols)
+        : words_(new std::atomic<uint64_t>[(size_t(rows) * cols + 15) / 16]()), cols_(size_t(cols)) {}
+
+    // Marks (r, c) as reached from direction d; false if it already was. Shared is false while one thread runs.
+    template <bool Shared>
+    bool claim(int r, int c, unsigned d) {
+        const size_t i = size_t(r) * cols_ + c;
+        std::atomic<uint64_t> &w = words_[i / 16];
+        const unsigned shift = unsigned(i % 16) * 4;
+        const uint64_t mark = uint64_t(4 | d) << shift;
+        uint64_t old = w.load(std::memory_order_relaxed);
+        if (!Shared) {
+            if (old >> shift & 0xF)
+                return false;
+            w.store(old | mark, std::memory_order_relaxed);
+            return true;
+        }
+        do {
+            if (old >> shift & 0xF)
+                return false;
+        } while (!w.compare_exchange_weak(old, old | mark, std::memory_order_relaxed));
+        return true;
+    }
+
+    // Parent direction of a reached cell, read once the threads are done.
+    int get(int r, int c) const {
+        const size_t i = size_t(r) * cols_ + c;
+        return int(words_[i / 16].load(std::memory_order_relaxed) >> (i % 16 * 4) & 3);
+    }
+};
+
+/*
+ Level-synchronous breadth-first search on up to threads threads, driven by a
+ level_expander; threads claim cells in a shared claim_plane. The path is as
+ short as the one of search_bfs.
+ */
+template <typename View>
+void search_parallel(const cell_graph<View> &g, node start, node goal, int threads, solve_result &res) {
+    claim_plane marks(g.rows, g.cols);
+    marks.claim<false>(start.r, start.c, 0);
+    std::vector<node> frontier(1, start);
+    level_expander<node> expander(threads);
+    std::atomic<bool> found(start.r == goal.r && start.c == goal.c);
+
+    // Expands frontier[first, end) into out; shared is std::true_type while other threads run.
+    auto expand = [&](auto shared, size_t first, size_t end, std::vector<node> &out) {
+        for (size_t i = first; i < end; ++i) {
+            const node n = frontier[i];
+            for (int d = 0; d < 4; ++d) {
+                if (!g.open(n.r, n.c, d))
+                    continue;
+                int nr = n.r + dir_row[d], nc = n.c + dir_col[d];
+                if (!marks.template claim<decltype(shared)::value>(nr, nc, unsigned(d ^ 2)))
+                    continue;
+                if (nr == goal.r && nc == goal.c)
+                    found.store(true, std::memory_order_relaxed);
+                out.push_back({nr, nc});
+            }
+        }
+    };
+
+    while (!found.load(std::memory_order_relaxed)) {
+        res.stats.nodes_expanded += frontier.size();
+        if (!expander.step(frontier, expand))
+            break;
+    }
+
+    if (found.load()) {
+        trace(marks, goal.r, goal.c, start.r, start.c, res.path);
+        std::reverse(res.path.begin(), res.path.end());
+        res.found = true;
+    }
+}
+
+// True if c is a cell position (odd coordinates) inside a height x width grid.
+bool is_cell_position(const cell &c, int height, int width) {
+    return c.x % 2 == 1 && c.y % 2 == 1 && c.x < unsigned(height - 1) && c.y < unsigned(width - 1);
+}
+
+}
+
+/*
+Finds a path between two cells of a maze view with the chosen algorithm.
+param maze The maze to search.
+param algo Search algorithm.
+param start Start cell, a grid position with odd coordinates.
+param goal Goal cell, a grid position with odd coordinates.
+param threads Threads of solver_algorithm::parallel, 0 for one per hardware thread; the other algorithms run on one.
+return The path (empty and found == false if there is none or a cell is invalid) and search statistics.
+ */
+template <typename View>
+solve_result find_path(const View &maze, solver_algorithm algo, const cell &start, const cell &goal, int threads) {
+    solve_result res;
+    if (!is_cell_position(start, maze.height(), maze.width()) || !is_cell_position(goal, maze.height(), maze.width()))
+        return res;
+
+    MAZE_PROFILE_SCOPE(solve);
+    auto begin = std::chrono::steady_clock::now();
+    cell_graph<View> g(maze);
+    node s{int(start.x / 2), int(start.y / 2)}, t{int(goal.x / 2), int(goal.y / 2)};
+
+    switch (algo) {
+    case solver_algorithm::bfs: search_bfs(g, s, t, res); break;
+    case solver_algorithm::astar: search_astar(g, s, t, res); break;
+    case solver_algorithm::bidirectional: search_bidirectional(g, s, t, res); break;
+    case solver_algorithm::dfs: search_dfs(g, s, t, res); break;
+    case solver_algorithm::parallel:
+        search_parallel(g, s, t, threads > 0 ? threads : int(std::max(1u, std::thread::hardware_concurrency())), res);
+        break;
+    }
+
+    res.stats.elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    MAZE_PROFILE_COUNT(nodes_expanded, res.stats.nodes_expanded);
+    return res;
+}
+
+template solve_result find_path<grid_view>(const grid_view &, solver_algorithm, const cell &, const cell &, int);
+template solve_result find_path<compact_walls>(const compact_walls &, solver_algorithm, const cell &, const cell &,
+                                               int);
+template solve_result find_path<mapped_maze>(const mapped_maze &, solver_algorithm, const cell &, const cell &, int);
+template solve_result find_path<region_view<mapped_maze>>(const region_view<mapped_maze> &, solver_algorithm,
+                                                          const cell &, const cell &, int);
+
+}
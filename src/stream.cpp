@@ -0,0 +1,120 @@
+#include "maze.h"
+#include <cassert>
+
+namespace maze_gen {
+
+void text_sink::begin(int, int width) {
+    line_.resize(simd::text_row_capacity(width) + 1);
+}
+
+void text_sink::row(const char *row, int width) {
+    if (line_.size() < simd::text_row_capacity(width) + 1)
+        line_.resize(simd::text_row_capacity(width) + 1);
+    size_t n = simd::expand_text_row(row, width, &line_[0], false);
+    line_[n++] = '\n';
+    out_.write(line_.data(), std::streamsize(n));
+}
+
+void text_sink::end() {
+    out_ << std::flush;
+}
+
+/*
+Opens the output file; check ok() before streaming.
+param filename Path of the file to write.
+param name Maze name stored in the file header.
+ */
+file_sink::file_sink(const std::string &filename, const std::string &name, bool compress)
+    : file_(filename, std::ios::binary), name_(name), compress_(compress), height_(0), x_(0) {}
+
+file_sink::~file_sink() = default;
+
+// Writes the header.
+void file_sink::begin(int height, int width) {
+    height_ = height;
+    x_ = 0;
+    writer_.reset(new maze_writer(file_, name_, height, width, false, compress_));
+    words_.assign((size_t((width - 1) / 2) * 2 + 63) / 64, 0);
+}
+
+/*
+Collects east passages from a cell row and south passages from the wall row below it,
+then writes the finished logical row.
+ */
+void file_sink::row(const char *row, int width) {
+    const int cols = (width - 1) / 2;
+    if (x_ % 2 == 1) {
+        std::fill(words_.begin(), words_.end(), 0);
+        for (int c = 0; c + 1 < cols; ++c)
+            if (row[2 * c + 2] != WALL)
+                words_[c / 32] |= uint64_t(compact_walls::east) << (2 * (c % 32));
+    } else if (x_ > 0) {
+        if (x_ < height_ - 1)
+            for (int c = 0; c < cols; ++c)
+                if (row[2 * c + 1] != WALL)
+                    words_[c / 32] |= uint64_t(compact_walls::south) << (2 * (c % 32));
+        writer_->write_row(words_.data());
+    }
+    ++x_;
+}
+
+void file_sink::end() {
+    if (writer_)
+        writer_->finish();
+}
+
+/*
+Generates a maze with Eller's algorithm and hands each grid row to the sink as soon
+as it is final. Only one row of set labels and one row of characters are held, so
+memory is proportional to the width and the height is unbounded.
+The maze is the same one generate_maze() builds with the eller algorithm and the same seed.
+param sink Receiver of the rows.
+ */
+void maze_generator::stream_maze(row_sink &sink) {
+    assert(width > 3 && height > 3 && width % 2 == 1 && height % 2 == 1);
+
+    if (width < 1 || height < 1) {
+        std::cout << "Please define width and height and/or load pre-made maze" << std::endl;
+        return;
+    }
+
+    if (!fixed_seed)
+        seed = (uint64_t(std::random_device{}()) << 32) | std::random_device{}();
+    rng.seed(mix_seed(seed, 0));
+
+    const int rows = (height - 1) / 2, cols = (width - 1) / 2;
+    eller_rows source(cols);
+    std::vector<unsigned char> links(cols);
+    std::vector<char> line(width, WALL);
+
+    sink.begin(height, width);
+    line[1] = CELL; // Entrance
+    sink.row(line.data(), width);
+
+    for (int r = 0; r < rows && sink.ok(); ++r) {
+        source.next(rng, r + 1 == rows, links.data());
+
+        // Cell row with its east passages
+        std::fill(line.begin(), line.end(), WALL);
+        for (int c = 0; c < cols; ++c) {
+            line[2 * c + 1] = CELL;
+            if (links[c] & compact_walls::east)
+                line[2 * c + 2] = CELL;
+        }
+        sink.row(line.data(), width);
+
+        // Wall row below it: south passages, or the bottom border with the exit
+        std::fill(line.begin(), line.end(), WALL);
+        if (r + 1 == rows) {
+            line[width - 2] = CELL;
+        } else {
+            for (int c = 0; c < cols; ++c)
+                if (links[c] & compact_walls::south)
+                    line[2 * c + 1] = CELL;
+        }
+        sink.row(line.data(), width);
+    }
+    sink.end();
+}
+
+}